@@ -0,0 +1,185 @@
+#include <cstdint>
+#include <format>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+
+#include "Driver.hpp"
+#include "backend/Pipeline.hpp"
+#include "backend/Target.hpp"
+
+// Ahead of time compilation of microC source to a native object, or an executable.
+//
+// The microC main is renamed, and a C main is generated which reads arguments from the command line (see `Context::generate_entry`).
+// Executables are linked with the runtime archive, and so have no dependency on LLVM.
+
+#ifndef MICROC_RUNTIME_ARCHIVE
+#define MICROC_RUNTIME_ARCHIVE ""
+#endif
+
+// Exits with a message.
+[[noreturn]] void fail(std::string what) {
+  llvm::errs() << "microCC: " << what << "\n";
+  std::exit(1);
+}
+
+// Emits `module` as a native object to `path`, using `tm`.
+void emit_object(llvm::Module &module, llvm::TargetMachine &tm, std::string path) {
+  std::error_code ec;
+  llvm::raw_fd_ostream out(path, ec, llvm::sys::fs::OF_None);
+  if (ec) {
+    fail(std::format("Unable to open {}: {}", path, ec.message()));
+  }
+
+  llvm::legacy::PassManager pm;
+  if (tm.addPassesToEmitFile(pm, out, nullptr, llvm::CodeGenFileType::ObjectFile)) {
+    fail("The target does not support emission of objects");
+  }
+
+  pm.run(module);
+  out.flush();
+}
+
+// Links `object` with the runtime to an executable at `path`, using the system C compiler as a linker driver.
+void link_executable(std::string object, std::string runtime, std::string path) {
+  auto cc = llvm::sys::findProgramByName("cc");
+  if (!cc) {
+    fail("Unable to find cc to link with");
+  }
+
+  std::vector<llvm::StringRef> cc_args{*cc, object, runtime, "-o", path};
+  std::string err_str;
+  if (llvm::sys::ExecuteAndWait(*cc, cc_args, std::nullopt, {}, 0, 0, &err_str) != 0) {
+    fail(std::format("Linking failed {}", err_str));
+  }
+}
+
+int main(int argc, char *argv[]) {
+  llvm::InitializeNativeTarget();
+  llvm::InitializeNativeTargetAsmParser();
+  llvm::InitializeNativeTargetAsmPrinter();
+
+  bool object_only = false;
+  unsigned opt_level{2};
+  std::optional<std::string> out_path{std::nullopt};
+  std::string runtime{MICROC_RUNTIME_ARCHIVE};
+  std::optional<std::string> cpu{std::nullopt};
+  std::optional<std::string> features{std::nullopt};
+  bool checked = false;
+
+  std::vector<std::string> args{};
+
+  for (size_t i = 1; i < argc; ++i) {
+    if (argv[i] == std::string("-c")) {
+      object_only = true;
+    } else if (argv[i] == std::string("-o") && i + 1 < argc) {
+      out_path = argv[++i];
+    } else if (argv[i][0] == '-' && argv[i][1] == 'O') {
+      std::string level(argv[i] + 2);
+      if (level.size() != 1 || level[0] < '0' || '3' < level[0]) {
+        fail(std::format("Unsupported optimisation level: {}", argv[i]));
+      }
+      opt_level = level[0] - '0';
+    } else if (argv[i] == std::string("--checked")) {
+      checked = true;
+    } else if (std::string(argv[i]).starts_with("--runtime=")) {
+      runtime = std::string(argv[i]).substr(std::string("--runtime=").size());
+    } else if (std::string(argv[i]).starts_with("--cpu=")) {
+      cpu = std::string(argv[i]).substr(std::string("--cpu=").size());
+    } else if (std::string(argv[i]).starts_with("--features=")) {
+      features = std::string(argv[i]).substr(std::string("--features=").size());
+    }
+
+    else {
+      args.push_back(argv[i]);
+    }
+  }
+
+  if (args.size() != 1) {
+    std::cout << "Usage: " << argv[0] << " [-O<0-3>] [-c] [-o <out>] [--checked] [--cpu=<cpu>] [--features=<features>] [--runtime=<archive>] <source>" << "\n";
+    std::exit(-1);
+  }
+
+  std::string source = args[0];
+
+  if (!out_path.has_value()) {
+    llvm::SmallString<128> stem(llvm::sys::path::stem(source));
+    if (object_only) {
+      stem.append(".o");
+    }
+    out_path = std::string(stem);
+  }
+
+  Pipeline pipeline(opt_level);
+  pipeline.range_checks = checked;
+
+  // The host, with code suitable for position independent executables.
+  // Note, by default executables use each feature of the host CPU, and so may not run on other machines.
+  auto jtmb = detect_target(cpu, features);
+  if (!jtmb) {
+    fail(llvm::toString(jtmb.takeError()));
+  }
+  jtmb->setCodeGenOptLevel(pipeline.codegen_level());
+  jtmb->setRelocationModel(llvm::Reloc::PIC_);
+
+  auto tm = jtmb->createTargetMachine();
+  if (!tm) {
+    fail(llvm::toString(tm.takeError()));
+  }
+
+  pipeline.target_machine = tm->get();
+
+  Driver driver{};
+  driver.ctx.set_target(**tm);
+  driver.ctx.options.checked = checked;
+  if (driver.parse(source) != 0) {
+    fail(std::format("Unable to parse {}", source));
+  }
+  driver.generate_ir();
+
+  auto &module = *driver.ctx.module;
+
+  // The C main replaces the microC main, which is kept under a different name.
+  llvm::Function *main_fn = module.getFunction("main");
+  if (!main_fn) {
+    fail("No main fn");
+  }
+  main_fn->setName("microc.main");
+  driver.ctx.generate_entry(main_fn, "main");
+
+  if (llvm::verifyModule(module, &llvm::errs())) {
+    fail("Error constructing module");
+  }
+
+  pipeline.infer_attributes(module);
+
+  pipeline.run(module);
+
+  if (object_only) {
+    emit_object(module, **tm, out_path.value());
+    return 0;
+  }
+
+  llvm::SmallString<128> object_path;
+  if (auto ec = llvm::sys::fs::createTemporaryFile("microCC", "o", object_path)) {
+    fail(std::format("Unable to create temporary object: {}", ec.message()));
+  }
+
+  emit_object(module, **tm, std::string(object_path));
+  link_executable(std::string(object_path), runtime, out_path.value());
+  llvm::sys::fs::remove(object_path);
+
+  return 0;
+}
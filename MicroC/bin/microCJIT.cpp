@@ -1,10 +1,24 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <cstdio>
+#include <format>
+#include <optional>
+#include <sstream>
 #include <string>
 #include <vector>
 
 #include "llvm/ADT/APInt.h"
-#include "llvm/ExecutionEngine/ExecutionEngine.h"
-#include "llvm/ExecutionEngine/MCJIT.h" // For JIT to be linked in
+#include "llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/RTDyldObjectLinkingLayer.h"
+#include "llvm/ExecutionEngine/Orc/TargetProcess/TargetExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
 #include "llvm/IR/BasicBlock.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/LLVMContext.h"
@@ -13,11 +27,27 @@
 #include "llvm/IR/Verifier.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Support/raw_ostream.h"
-#include <llvm/ExecutionEngine/GenericValue.h>
 #include <llvm/IR/GlobalVariable.h>
 #include <llvm/Linker/Linker.h>
 
 #include "Driver.hpp"
+#include "backend/ObjectCache.hpp"
+#include "backend/PerfMap.hpp"
+#include "backend/Pipeline.hpp"
+#include "backend/Profile.hpp"
+#include "backend/ProfileReport.hpp"
+#include "backend/Report.hpp"
+#include "backend/Target.hpp"
+#include "backend/Tiering.hpp"
+#include "runtime/primatives.h"
+
+// The name of the generated entry fn, through which main is called.
+static const char *ENTRY_NAME = "microc.entry";
+
+// The tiering of the JIT, if enabled, for requests from tier 0 code.
+static Tiering *TIERING{nullptr};
+
+static void microc_tier_up(int64_t id) { TIERING->request(id); }
 
 // The main thing, bundling most tasks.
 struct Thing {
@@ -26,25 +56,93 @@ struct Thing {
   // The source file.
   std::string source;
 
-  // The argument to be passed to main.
-  int64_t arg = 0;
+  // The arguments of each run of main.
+  // Outside of batch mode there is a single run.
+  std::vector<std::vector<std::string>> runs{};
+
+  // If set, printed on a line of its own after each run.
+  std::optional<std::string> separator{std::nullopt};
+
+  // Whether to print the time taken by each run, to stderr.
+  bool time_runs{false};
+
+  // The optimisation pipeline, run on each fn as it is compiled.
+  Pipeline pipeline{2};
+
+  // The count of threads for codegen and compilation.
+  // With more than one, codegen is partitioned, and each partition is compiled whole and concurrently, ahead of execution.
+  unsigned jobs{1};
+
+  // The target, detected with `detect_target`.
+  std::optional<llvm::orc::JITTargetMachineBuilder> jtmb{std::nullopt};
+
+  // A target machine for the pipeline, created from `jtmb`.
+  // The JIT creates its own target machine for compilation.
+  std::unique_ptr<llvm::TargetMachine> target_machine{nullptr};
+
+  // Listeners for perf, if enabled, notified of each object linked by the JIT.
+  // Held ahead of the JIT, so each outlives the JIT.
+  // The jitdump listener is owned by LLVM, and is null if LLVM was built without it.
+  std::unique_ptr<PerfMapListener> perf_map{nullptr};
+  llvm::JITEventListener *perf_jitdump{nullptr};
 
   // The JIT engine, built after generating IR with `build_execution_engine`.
-  llvm::ExecutionEngine *execution_engine{nullptr};
+  // Fns are compiled lazily, on first call through a stub, and so the cost of compilation is proportional to the code executed.
+  // The exception is when the object cache is used, as the cache holds an object for the whole module.
+  std::unique_ptr<llvm::orc::LLLazyJIT> jit{nullptr};
+
+  // The persistent object cache, if enabled.
+  std::unique_ptr<ObjectCache> cache{nullptr};
+
+  // The key of the source in the cache.
+  std::string cache_key{};
+
+  // The object found in the cache, if any, with which parsing and codegen are skipped.
+  std::unique_ptr<llvm::MemoryBuffer> cached_object{nullptr};
+
+  // Where to write the profile of an instrumented module, if set, and the layout and counts of the profile.
+  std::optional<std::string> pgo_generate{std::nullopt};
+  Profile profile{};
+
+  // The profile to attach to the module, if set.
+  std::optional<Profile> pgo_use{std::nullopt};
+
+  // The counts of profile counters, if enabled.
+  std::unique_ptr<ProfileReport> profile_report{nullptr};
+
+  // Tiered execution, if enabled.
+  // Tier 1 definitions are extracted from `tier1_source`, a copy of the module before tier 0 is instrumented, and added to `tier1_dylib`.
+  std::unique_ptr<Tiering> tiering{nullptr};
+  std::optional<llvm::orc::ThreadSafeModule> tier1_source{std::nullopt};
+  llvm::orc::JITDylib *tier1_dylib{nullptr};
+
+  // Statistics on phases of the compiler, if requested.
+  std::unique_ptr<Report> report{nullptr};
 
   // Struct for parsing, and codegen by extension
   Driver driver{};
 
   // Initialisation from main
-  Thing(std::string source, int64_t arg) : source(source), arg(arg) {
+  Thing(std::string source, unsigned opt_level) : source(source), pipeline(opt_level) {
   }
 
-  // Print the module to stdout.
-  void print_module() {
-    std::cout << "The module:" << "\n"
-              << "---------" << "\n";
-    this->driver.ctx.module->print(llvm::outs(), nullptr);
-    std::cout << "---------" << "\n";
+  // The codegen context of each partition, of which there is one unless codegen is partitioned.
+  std::vector<Context *> contexts() {
+    std::vector<Context *> contexts{&this->driver.ctx};
+    for (auto &partition : this->driver.partitions) {
+      contexts.push_back(partition.get());
+    }
+    return contexts;
+  }
+
+  // Print the module (of each partition) to stdout, under `heading`.
+  void print_module(const std::string &heading = "The module:") {
+    for (auto ctx : this->contexts()) {
+      std::cout << heading << "\n"
+                << "---------" << "\n";
+      ctx->module->print(llvm::outs(), nullptr);
+      std::cout << "---------" << "\n";
+    }
   }
 
   // Print a 'canonical' representation of the source to stdout.
@@ -57,90 +155,614 @@ struct Thing {
               << "\n";
   }
 
+  // Collect statistics for a report.
+  void enable_report() {
+    this->report = std::make_unique<Report>();
+    this->pipeline.pass_timer = &this->report->pass_timer;
+  }
+
+  // Instrument the module to count fn entries and branch outcomes, and write the counts to `path` after execution.
+  void enable_pgo_generate(std::string path) { this->pgo_generate = path; }
+
+  // Attach the profile at `path` to the module before optimisation.
+  void enable_pgo_use(std::string path) {
+    auto profile = Profile::read(path);
+    if (!profile) {
+      exit_on_error(profile.takeError(), "Failed to read profile");
+    }
+    this->pgo_use = std::move(*profile);
+    this->pipeline.profiled = true;
+  }
+
+  // Instrument the module to generate a profile, if set.
+  // Before attribute inference, as counters are writes to memory, and so e.g. a fn with counters does not have `memory(none)`.
+  void instrument_profile() {
+    if (this->pgo_generate.has_value()) {
+      size_t counters = this->profile.instrument(*this->driver.ctx.module);
+      if (0 < verbosity) {
+        std::cout << "Profile: " << counters << " counters" << "\n";
+      }
+    }
+  }
+
+  // Attach a profile to the module, if set.
+  // After attribute inference, so fns made cold by the profile keep the inferred attributes.
+  void apply_profile() {
+    if (this->pgo_use.has_value()) {
+      size_t applied = this->pgo_use->apply(*this->driver.ctx.module);
+      if (0 < verbosity) {
+        std::cout << "Profile: applied to " << applied << " fns" << "\n";
+      }
+    }
+  }
+
+  // Read the counters of an instrumented module, and write the profile.
+  // Counts are summed over each run.
+  void write_profile() {
+    if (!this->pgo_generate.has_value()) {
+      return;
+    }
+
+    auto counters_addr = this->jit->lookup(Profile::COUNTERS_NAME);
+    if (!counters_addr) {
+      exit_on_error(counters_addr.takeError(), "Failed to find profile counters");
+    }
+    this->profile.collect(counters_addr->toPtr<const uint64_t *>());
+
+    std::error_code ec;
+    llvm::raw_fd_ostream out(this->pgo_generate.value(), ec);
+    if (ec) {
+      std::cout << "Unable to write profile: " << this->pgo_generate.value() << "\n";
+      return;
+    }
+    this->profile.write(out);
+  }
+
+  // Count fn entries, loop iterations, and if arms, and report the counts after execution.
+  void enable_profile() {
+    this->driver.ctx.options.profile = true;
+    this->profile_report = std::make_unique<ProfileReport>(this->source);
+  }
+
+  // Read the profile counters of each partition.
+  // Counts are summed over each run, as counters are not reset by the entry fn.
+  void collect_profile() {
+    if (!this->profile_report) {
+      return;
+    }
+
+    for (auto ctx : this->contexts()) {
+      if (ctx->profile_sites.empty()) {
+        continue;
+      }
+
+      auto counters_addr = this->jit->lookup(ctx->profile_counters_name);
+      if (!counters_addr) {
+        exit_on_error(counters_addr.takeError(), "Failed to find profile counters");
+      }
+      this->profile_report->collect(ctx->profile_sites, counters_addr->toPtr<const uint64_t *>());
+    }
+
+    this->profile_report->sort();
+  }
+
+  // Start each fn at tier 0, and tier up fns whose count of entries and loop iterations reaches `threshold`.
+  void enable_tiering(uint64_t threshold) {
+    this->tiering = std::make_unique<Tiering>();
+    this->tiering->threshold = threshold;
+    TIERING = this->tiering.get();
+  }
+
+  // Rewrite calls to go through the slots of each tier.
+  // Before attribute inference, as the loads from slots are memory accesses of the caller.
+  void rewrite_tiers() {
+    if (this->tiering) {
+      this->tiering->rewrite(*this->driver.ctx.module);
+    }
+  }
+
+  // Compile the tier 1 definition of fn `id` and swap the slot of the fn to it.
+  // Called on the background thread of `tiering`, and so errors are reported rather than fatal, with the fn left at tier 0.
+  void tier_up(size_t id) {
+    const std::string &fn = this->tiering->fns[id];
+
+    auto tsm = llvm::orc::cloneToNewContext(*this->tier1_source,
+                                            [&fn](const llvm::GlobalValue &gv) { return gv.getName() == fn; });
+    tsm.withModuleDo([&fn](llvm::Module &module) { Tiering::mark_optimised(module, fn); });
+
+    if (auto err = this->jit->addIRModule(*this->tier1_dylib, std::move(tsm))) {
+      llvm::logAllUnhandledErrors(std::move(err), llvm::errs(), std::format("Tier up of {} failed: ", fn));
+      return;
+    }
+
+    auto optimised = this->jit->lookup(*this->tier1_dylib, Tiering::optimised_name(fn));
+    if (!optimised) {
+      llvm::logAllUnhandledErrors(optimised.takeError(), llvm::errs(), std::format("Tier up of {} failed: ", fn));
+      return;
+    }
+
+    auto slot = this->jit->lookup(Tiering::slot_name(fn));
+    if (!slot) {
+      llvm::logAllUnhandledErrors(slot.takeError(), llvm::errs(), std::format("Tier up of {} failed: ", fn));
+      return;
+    }
+
+    std::atomic_ref<void *>(*slot->toPtr<void **>()).store(optimised->toPtr<void *>(), std::memory_order_release);
+
+    if (0 < verbosity) {
+      llvm::errs() << std::format("Tier up: {}", fn) << "\n";
+    }
+  }
+
+  // Stop tiering, after any tier up in progress.
+  void stop_tiering() {
+    if (this->tiering) {
+      this->tiering->stop();
+    }
+  }
+
+  // Check indices into arrays with an area, and have the pipeline remove checks where possible.
+  void enable_checks() {
+    this->driver.ctx.options.checked = true;
+    this->pipeline.range_checks = true;
+  }
+
+  // Write a perf map, and a jitdump if available, for each object linked, with line tables from the source.
+  void enable_perf() {
+    this->driver.ctx.options.debug_info = true;
+    this->perf_map = std::make_unique<PerfMapListener>();
+    this->perf_jitdump = llvm::JITEventListener::createPerfJITEventListener();
+
+    if (!this->perf_jitdump) {
+      llvm::errs() << "perf: jitdump unavailable, writing " << this->perf_map->path << " only" << "\n";
+    } else if (0 < verbosity) {
+      std::cout << "perf: writing " << this->perf_map->path << " and jitdump" << "\n";
+    }
+  }
+
   // Parse the source to an AST, held in `driver`.
   void parse() {
+    Report::Timer timer(this->report.get(), "parse");
     if (0 < verbosity) {
       std::cout << "Parsing... ";
     }
     this->driver.parse(this->source);
+    if (this->report) {
+      this->report->ast_nodes = this->driver.node_counts_by_name();
+      this->report->ast_bytes = this->driver.ctx.arena.bytes_allocated();
+    }
     if (0 < verbosity) {
       std::cout << "OK" << "\n";
     }
   }
 
-  // Generate LLVM IR for an AST.
+  // Generate LLVM IR for an AST, and an entry fn to call main with.
   void generate_ir() {
+    Report::Timer timer(this->report.get(), "generate_ir");
     if (0 < verbosity) {
       std::cout << "Generating LLVM IR... ";
     }
-    this->driver.generate_ir();
+    if (1 < this->jobs) {
+      this->driver.generate_ir_partitioned(this->jobs);
+    } else {
+      this->driver.generate_ir();
+    }
+
+    // The first partition defines globals, and so the entry fn which resets them.
+    llvm::Function *main_fn = this->driver.ctx.module->getFunction("main");
+    if (!main_fn) {
+      std::cout << "No main fn" << "\n";
+      std::exit(1);
+    }
+    this->driver.ctx.generate_entry(main_fn, ENTRY_NAME);
+
+    if (this->report) {
+      for (auto ctx : this->contexts()) {
+        this->report->record_module(*ctx->module);
+        this->report->bounds_checks += ctx->bounds_checks;
+      }
+    }
     if (0 < verbosity) {
       std::cout << "OK" << "\n";
     }
   }
 
   void verify() {
+    Report::Timer timer(this->report.get(), "verify");
     if (0 < verbosity) {
       std::cout << "Verifying... ";
     }
-    if (llvm::verifyModule(*this->driver.ctx.module, &llvm::outs())) {
-      llvm::errs() << "Error constructing function!";
-      std::exit(1);
+    for (auto ctx : this->contexts()) {
+      if (llvm::verifyModule(*ctx->module, &llvm::outs())) {
+        llvm::errs() << "Error constructing function!";
+        std::exit(1);
+      }
     }
     if (0 < verbosity) {
       std::cout << "OK" << "\n";
     }
   }
 
-  void build_execution_engine() {
-    if (0 < verbosity) {
-      std::cout << "Building execution engine... ";
+  // Infer fn attributes over the module, which requires a valid module.
+  // With partitions, attributes are inferred over each partition, and copied to the declarations of other partitions (see `Pipeline`).
+  void infer_attributes() {
+    Report::Timer timer(this->report.get(), "infer_attributes");
+    std::vector<llvm::Module *> modules{};
+    for (auto ctx : this->contexts()) {
+      modules.push_back(ctx->module.get());
     }
-    std::string err_str;
-    this->execution_engine = llvm::EngineBuilder(std::move(this->driver.ctx.module))
-                                 .setEngineKind(llvm::EngineKind::JIT)
-                                 .setErrorStr(&err_str)
-                                 .create();
-
-    // std::cout << "Extending global mapping... " << "\n";
-    // for (auto &elem : bundle.driver.llvm.foundation_fn_map) {
-    //   auto fn_ptr = elem.second;
-    //   std::cout << "\tAdded: " << fn_ptr->name << "\n";
-    //   execution_engine->addGlobalMapping(fn_ptr->name, fn_ptr->global_map_addr());
-    // }
-
-    if (!execution_engine) {
-      std::cout << "Failed to construct execution engine: " << err_str << "\n";
+    this->pipeline.infer_attributes(modules);
+  }
+
+  // Exits with a message if `err` holds an error.
+  void exit_on_error(llvm::Error err, std::string what) {
+    if (err) {
+      std::cout << what << ": " << llvm::toString(std::move(err)) << "\n";
       std::exit(1);
-    } else {
+    }
+  }
+
+  // Detect the host, for the JIT, the pipeline, and the cache key.
+  // The module is given the triple and data layout of the target, ahead of codegen.
+  void detect_target(std::optional<std::string> cpu, std::optional<std::string> features) {
+    auto jtmb = ::detect_target(cpu, features);
+    if (!jtmb) {
+      exit_on_error(jtmb.takeError(), "Failed to detect host");
+    }
+    jtmb->setCodeGenOptLevel(this->pipeline.codegen_level());
+
+    auto tm = jtmb->createTargetMachine();
+    if (!tm) {
+      exit_on_error(tm.takeError(), "Failed to create target machine");
+    }
+    this->target_machine = std::move(*tm);
+    this->pipeline.target_machine = this->target_machine.get();
+    this->driver.ctx.set_target(*this->target_machine);
+
+    if (0 < verbosity) {
+      std::cout << "Target: " << jtmb->getTargetTriple().str() << " " << jtmb->getCPU() << "\n";
+    }
+
+    this->jtmb = std::move(*jtmb);
+  }
+
+  // Use a persistent object cache held in `directory`.
+  void enable_cache(std::string directory) {
+    this->cache = std::make_unique<ObjectCache>(directory);
+  }
+
+  // Look for an object compiled from the source in the cache.
+  // Returns true on a hit, in which case parsing and codegen should be skipped.
+  bool cache_lookup() {
+    if (!this->cache) {
+      return false;
+    }
+
+    // The source is hashed before parsing, and stdin can only be read once.
+    auto source_buffer = llvm::MemoryBuffer::getFile(this->source == "-" ? "" : this->source);
+    if (!source_buffer) {
       if (0 < verbosity) {
-        std::cout << "OK" << "\n";
+        std::cout << "Cache: unavailable for " << this->source << "\n";
       }
+      this->cache.reset();
+      return false;
+    }
+
+    // Anything which changes the object, other than the source.
+    auto configuration = std::format("O{};{};{};{};{}",
+                                     this->pipeline.level,
+                                     this->jtmb->getTargetTriple().str(),
+                                     this->jtmb->getCPU(),
+                                     this->jtmb->getFeatures().getString(),
+                                     this->driver.ctx.options.checked ? "checked" : "unchecked");
+
+    // Line tables are part of the object.
+    if (this->driver.ctx.options.debug_info) {
+      configuration += ";lines";
+    }
+
+    // The counts of a profile are part of the object.
+    if (this->pgo_use.has_value()) {
+      std::string profile_text{};
+      llvm::raw_string_ostream profile_stream(profile_text);
+      this->pgo_use->write(profile_stream);
+      configuration += ";pgo-use;" + profile_text;
+    }
+
+    this->cache_key = ObjectCache::key((*source_buffer)->getBuffer(), configuration);
+    this->cached_object = this->cache->lookup(this->cache_key);
+
+    if (0 < verbosity) {
+      std::cout << "Cache: " << (this->cached_object ? "hit" : "miss") << " (" << this->cache_key << ")" << "\n";
     }
+
+    return this->cached_object != nullptr;
   }
 
-  //
-  int execute_main() {
-    if (!this->execution_engine) {
-      throw std::logic_error("Execution requires engine");
+  // Update the persistent counts of the cache, if used.
+  void cache_record() {
+    if (!this->cache) {
+      return;
+    }
+
+    this->cache->record();
+    if (0 < verbosity) {
+      std::cout << "Cache: " << this->cache->total_hits << " hits, " << this->cache->total_misses << " misses" << "\n";
     }
+  }
+
+  // The symbols of the runtime, with addresses in this process.
+  llvm::orc::SymbolMap runtime_symbols() {
+    auto callable = llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable;
+    auto data = llvm::JITSymbolFlags::Exported;
 
-    auto main_ptr = this->execution_engine->getFunctionAddress("main");
-    if (!main_ptr) {
-      throw std::logic_error("Failed to identify main fn for JIT");
+    llvm::orc::SymbolMap symbols{};
+
+    for (auto &[name, primative] : this->driver.ctx.foundation_fn_map) {
+      symbols[this->jit->mangleAndIntern(name)] = {llvm::orc::ExecutorAddr(primative->global_map_addr()), callable};
     }
 
-    int64_t (*main)(int64_t) = (int64_t (*)(int64_t))main_ptr;
+    symbols[this->jit->mangleAndIntern("microc_arg")] = {llvm::orc::ExecutorAddr::fromPtr(&microc_arg), callable};
+    symbols[this->jit->mangleAndIntern("microc_flush")] = {llvm::orc::ExecutorAddr::fromPtr(&microc_flush), callable};
+    symbols[this->jit->mangleAndIntern("microc_bounds_fail")] = {llvm::orc::ExecutorAddr::fromPtr(&microc_bounds_fail), callable};
+    if (this->tiering) {
+      symbols[this->jit->mangleAndIntern(Tiering::TIER_UP_NAME)] = {llvm::orc::ExecutorAddr::fromPtr(&microc_tier_up), callable};
+    }
+    symbols[this->jit->mangleAndIntern("microc_out_buf")] = {llvm::orc::ExecutorAddr::fromPtr(&microc_out_buf), data};
+    symbols[this->jit->mangleAndIntern("microc_out_len")] = {llvm::orc::ExecutorAddr::fromPtr(&microc_out_len), data};
 
+    return symbols;
+  }
+
+  void build_execution_engine() {
+    Report::Timer timer(this->report.get(), "build_execution_engine");
     if (0 < verbosity) {
-      std::cout << "Executing..." << "\n"
-                << "------" << "\n";
+      std::cout << "Building execution engine... ";
+    }
+
+    llvm::orc::LLLazyJITBuilder builder{};
+    builder.setJITTargetMachineBuilder(*this->jtmb);
+
+    // Partitions are compiled on a pool of threads, with a compiler (and target machine) for each compile.
+    if (1 < this->jobs) {
+      builder.setNumCompileThreads(this->jobs);
+    }
+
+    // With tiering, the codegen level of each module depends on the tier.
+    if (this->tiering) {
+      builder.setCompileFunctionCreator(
+          [](llvm::orc::JITTargetMachineBuilder jtmb)
+              -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+            return std::make_unique<TieredCompiler>(std::move(jtmb));
+          });
+    }
+
+    // On a miss objects are written to the cache by the compiler.
+    else if (this->cache) {
+      builder.setCompileFunctionCreator(
+          [cache = this->cache.get()](llvm::orc::JITTargetMachineBuilder jtmb)
+              -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+            auto tm = jtmb.createTargetMachine();
+            if (!tm) {
+              return tm.takeError();
+            }
+            return std::make_unique<llvm::orc::TMOwningSimpleCompiler>(std::move(*tm), cache);
+          });
+    }
+
+    // Event listeners are only notified by RuntimeDyld, so with perf objects are linked with RuntimeDyld rather than JITLink.
+    // The arguments of the creator, and of the memory manager creator, differ across versions of LLVM, and are unused.
+    if (this->perf_map) {
+      builder.setObjectLinkingLayerCreator(
+          [perf_map = this->perf_map.get(), perf_jitdump = this->perf_jitdump](llvm::orc::ExecutionSession &es, auto &&...)
+              -> llvm::Expected<std::unique_ptr<llvm::orc::ObjectLayer>> {
+            auto layer = std::make_unique<llvm::orc::RTDyldObjectLinkingLayer>(
+                es, [](auto &&...) { return std::make_unique<llvm::SectionMemoryManager>(); });
+
+            layer->registerJITEventListener(*perf_map);
+            if (perf_jitdump) {
+              layer->registerJITEventListener(*perf_jitdump);
+            }
+            return std::move(layer);
+          });
+    }
+
+    auto jit = builder.create();
+    if (!jit) {
+      exit_on_error(jit.takeError(), "Failed to construct execution engine");
+    }
+    this->jit = std::move(*jit);
+
+    // The module is partitioned into a module per fn before compilation, so optimisation is applied to each partition.
+    // This keeps optimisation lazy, at the cost of cross-fn optimisations such as inlining.
+    // The exception is foundation fns, whose IR bodies are restored in each partition, and so may be inlined.
+    //
+    // With tiering, tier 0 is not optimised, and tier 1 is optimised away from the main thread, so without pass timings.
+    //
+    // When modules may be optimised concurrently (with tiering or partitions) each run of the pipeline has a target machine of its own.
+    // Pass timings are only kept on the main thread, as the handler is not thread safe.
+    Pipeline tier0 = this->pipeline;
+    Pipeline tier1 = this->pipeline;
+    if (this->tiering) {
+      tier0.level = 0;
+      tier1.pass_timer = nullptr;
+    }
+    if (1 < this->jobs) {
+      tier0.pass_timer = nullptr;
+    }
+    bool concurrent = this->tiering || 1 < this->jobs;
+
+    this->jit->getIRTransformLayer().setTransform(
+        [tier0, tier1, concurrent, jtmb = *this->jtmb, foundation = this->driver.ctx.foundation_fn_map, report = this->report.get()](
+            llvm::orc::ThreadSafeModule tsm, llvm::orc::MaterializationResponsibility &r)
+            -> llvm::Expected<llvm::orc::ThreadSafeModule> {
+          std::unique_ptr<llvm::TargetMachine> tm{nullptr};
+          if (concurrent) {
+            llvm::orc::JITTargetMachineBuilder module_jtmb = jtmb;
+            auto created = module_jtmb.createTargetMachine();
+            if (!created) {
+              return created.takeError();
+            }
+            tm = std::move(*created);
+          }
+
+          tsm.withModuleDo([&tier0, &tier1, &tm, &foundation, report](llvm::Module &module) {
+            Pipeline pipeline = Tiering::is_optimised(module) ? tier1 : tier0;
+            if (tm) {
+              pipeline.target_machine = tm.get();
+            }
+
+            for (auto &[name, primative] : foundation) {
+              llvm::Function *fn = module.getFunction(name);
+              if (fn && fn->isDeclaration()) {
+                primative->define(fn);
+              }
+            }
+
+            pipeline.run(module);
+
+            if (report) {
+              report->record_bounds_checks(module);
+            }
+          });
+          return std::move(tsm);
+        });
+
+    // Each object is linked through the object transform layer, including any from the cache.
+    if (this->report) {
+      this->jit->getObjTransformLayer().setTransform(
+          [report = this->report.get()](std::unique_ptr<llvm::MemoryBuffer> object)
+              -> llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>> {
+            report->record_object(object->getMemBufferRef());
+            return std::move(object);
+          });
+    }
+
+    // Other symbols, e.g. `memcpy` from lowering of intrinsics, are found in this process.
+    auto process_symbols = llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+        this->jit->getDataLayout().getGlobalPrefix());
+    if (!process_symbols) {
+      exit_on_error(process_symbols.takeError(), "Failed to find process symbols");
     }
-    int64_t exit_code = main(this->arg);
+    this->jit->getMainJITDylib().addGenerator(std::move(*process_symbols));
+
+    // The runtime is linked into this process, and each symbol of the runtime is defined as an absolute symbol.
+    // So, no search is made for foundation fns (or support for them) when linking.
+    exit_on_error(this->jit->getMainJITDylib().define(llvm::orc::absoluteSymbols(this->runtime_symbols())),
+                  "Failed to define runtime symbols");
+
+    if (this->cached_object) {
+      exit_on_error(this->jit->addObjectFile(std::move(this->cached_object)), "Failed to add cached object");
+    }
+
+    else if (1 < this->jobs) {
+      this->add_partitions();
+    }
+
+    else {
+      // The module and context are handed over to the JIT, so neither is available after this point.
+      llvm::orc::ThreadSafeModule tsm(std::move(this->driver.ctx.module), std::move(this->driver.ctx.context));
+
+      // Tier 1 is derived from the module before tier 0 is instrumented.
+      if (this->tiering) {
+        this->tier1_source = llvm::orc::cloneToNewContext(tsm);
+        tsm.withModuleDo([this](llvm::Module &module) { this->tiering->instrument(module); });
+
+        auto tier1_dylib = this->jit->createJITDylib("microc.tier1");
+        if (!tier1_dylib) {
+          exit_on_error(tier1_dylib.takeError(), "Failed to create tier 1 library");
+        }
+        this->tier1_dylib = &*tier1_dylib;
+        this->tier1_dylib->addToLinkOrder(this->jit->getMainJITDylib());
+
+        this->tiering->start([this](size_t id) { this->tier_up(id); });
+      }
+
+      // With a cache the module is compiled whole, and the identifier of the module is the key the object is written to.
+      if (this->cache) {
+        tsm.withModuleDo([this](llvm::Module &module) { module.setModuleIdentifier(this->cache_key); });
+        exit_on_error(this->jit->addIRModule(std::move(tsm)), "Failed to add module");
+      } else {
+        exit_on_error(this->jit->addLazyIRModule(std::move(tsm)), "Failed to add module");
+      }
+    }
+
     if (0 < verbosity) {
-      std::cout << "\n"
-                << "------" << "\n"
-                << "Exit code: " << exit_code << "\n";
+      std::cout << "OK" << "\n";
+    }
+  }
+
+  // Add each partition to the JIT, and compile each fn defined in a partition, concurrently.
+  // A single lookup of each fn is made, so the JIT dispatches the compilation of each partition to its pool of threads.
+  void add_partitions() {
+    llvm::orc::SymbolLookupSet fns{};
+
+    for (auto ctx : this->contexts()) {
+      for (auto &fn : *ctx->module) {
+        if (!fn.isDeclaration() && !fn.hasAvailableExternallyLinkage()) {
+          fns.add(this->jit->mangleAndIntern(fn.getName()));
+        }
+      }
+
+      llvm::orc::ThreadSafeModule tsm(std::move(ctx->module), std::move(ctx->context));
+      exit_on_error(this->jit->addIRModule(std::move(tsm)), "Failed to add module");
+    }
+
+    auto &main_dylib = this->jit->getMainJITDylib();
+    auto compiled = this->jit->getExecutionSession().lookup(llvm::orc::makeJITDylibSearchOrder(&main_dylib), std::move(fns));
+    if (!compiled) {
+      exit_on_error(compiled.takeError(), "Failed to compile partitions");
+    }
+  }
+
+  // Call main once for each run, through the entry fn.
+  // Globals are reset by the entry fn, so each run is independent of any other.
+  // Returns the first non-zero exit code, if any.
+  int execute_main() {
+    Report::Timer timer(this->report.get(), "execute_main");
+    if (!this->jit) {
+      throw std::logic_error("Execution requires engine");
+    }
+
+    auto entry_addr = this->jit->lookup(ENTRY_NAME);
+    if (!entry_addr) {
+      exit_on_error(entry_addr.takeError(), "Failed to identify entry fn for JIT");
+    }
+
+    auto entry = entry_addr->toPtr<int (*)(int, char *[])>();
+
+    int exit_code = 0;
+
+    for (size_t run = 0; run < this->runs.size(); ++run) {
+      if (0 < verbosity) {
+        std::cout << "Executing..." << "\n"
+                  << "------" << "\n";
+      }
+      std::cout.flush();
+
+      auto start = std::chrono::steady_clock::now();
+      int run_exit_code = llvm::orc::runAsMain(entry, this->runs[run], this->source);
+      microc_flush();
+      std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+      if (0 < verbosity) {
+        std::cout << "\n"
+                  << "------" << "\n"
+                  << "Exit code: " << run_exit_code << "\n";
+      }
+
+      if (this->separator.has_value()) {
+        std::cout << this->separator.value() << "\n";
+      }
+
+      if (this->time_runs) {
+        std::cout.flush();
+        std::cerr << std::format("Run {}: {:.3f} ms", run, elapsed.count()) << "\n";
+      }
+
+      if (exit_code == 0) {
+        exit_code = run_exit_code;
+      }
     }
 
     return exit_code;
@@ -157,6 +779,24 @@ int main(int argc, char *argv[]) {
   bool trace_parsing = false;
   bool trace_scanning = false;
   int8_t verbosity{0};
+  unsigned opt_level{2};
+  std::optional<std::string> cache_dir{std::nullopt};
+  std::optional<std::string> batch_file{std::nullopt};
+  bool batch_args = false;
+  std::optional<std::string> separator{std::nullopt};
+  bool time_runs = false;
+  bool report = false;
+  bool checked = false;
+  bool perf = false;
+  bool profile = false;
+  std::optional<std::string> profile_json{std::nullopt};
+  std::optional<uint64_t> tier_threshold{std::nullopt};
+  unsigned jobs{1};
+  std::optional<std::string> pgo_generate{std::nullopt};
+  std::optional<std::string> pgo_use{std::nullopt};
+  std::optional<std::string> report_json{std::nullopt};
+  std::optional<std::string> cpu{std::nullopt};
+  std::optional<std::string> features{std::nullopt};
 
   std::vector<std::string> args{};
 
@@ -171,6 +811,51 @@ int main(int argc, char *argv[]) {
       trace_scanning = true;
     } else if (argv[i] == std::string("-v")) {
       verbosity = 1;
+    } else if (argv[i][0] == '-' && argv[i][1] == 'O') {
+      std::string level(argv[i] + 2);
+      if (level.size() != 1 || level[0] < '0' || '3' < level[0]) {
+        std::cout << "Unsupported optimisation level: " << argv[i] << "\n";
+        std::exit(-1);
+      }
+      opt_level = level[0] - '0';
+    } else if (argv[i] == std::string("--cache")) {
+      cache_dir = ObjectCache::default_directory();
+    } else if (std::string(argv[i]).starts_with("--cache-dir=")) {
+      cache_dir = std::string(argv[i]).substr(std::string("--cache-dir=").size());
+    } else if (std::string(argv[i]).starts_with("--batch=")) {
+      batch_file = std::string(argv[i]).substr(std::string("--batch=").size());
+    } else if (argv[i] == std::string("--batch-args")) {
+      batch_args = true;
+    } else if (std::string(argv[i]).starts_with("--batch-sep=")) {
+      separator = std::string(argv[i]).substr(std::string("--batch-sep=").size());
+    } else if (argv[i] == std::string("--batch-time")) {
+      time_runs = true;
+    } else if (std::string(argv[i]).starts_with("--jobs=")) {
+      jobs = std::max(1, std::stoi(std::string(argv[i]).substr(std::string("--jobs=").size())));
+    } else if (argv[i] == std::string("--tiered")) {
+      tier_threshold = Tiering().threshold;
+    } else if (std::string(argv[i]).starts_with("--tier-threshold=")) {
+      tier_threshold = std::stoull(std::string(argv[i]).substr(std::string("--tier-threshold=").size()));
+    } else if (argv[i] == std::string("--checked")) {
+      checked = true;
+    } else if (argv[i] == std::string("--perf")) {
+      perf = true;
+    } else if (argv[i] == std::string("--profile")) {
+      profile = true;
+    } else if (std::string(argv[i]).starts_with("--profile-json=")) {
+      profile_json = std::string(argv[i]).substr(std::string("--profile-json=").size());
+    } else if (argv[i] == std::string("-time") || argv[i] == std::string("--report")) {
+      report = true;
+    } else if (std::string(argv[i]).starts_with("--report-json=")) {
+      report_json = std::string(argv[i]).substr(std::string("--report-json=").size());
+    } else if (std::string(argv[i]).starts_with("--pgo-generate=")) {
+      pgo_generate = std::string(argv[i]).substr(std::string("--pgo-generate=").size());
+    } else if (std::string(argv[i]).starts_with("--pgo-use=")) {
+      pgo_use = std::string(argv[i]).substr(std::string("--pgo-use=").size());
+    } else if (std::string(argv[i]).starts_with("--cpu=")) {
+      cpu = std::string(argv[i]).substr(std::string("--cpu=").size());
+    } else if (std::string(argv[i]).starts_with("--features=")) {
+      features = std::string(argv[i]).substr(std::string("--features=").size());
     }
 
     else {
@@ -179,40 +864,173 @@ int main(int argc, char *argv[]) {
   }
 
   if (args.empty()) {
-    std::cout << "Usage: " << argv[0] << " <source> [arg]" << "\n";
+    std::cout << "Usage: " << argv[0]
+              << " [-O<0-3>] [--jobs=<n>] [--tiered | --tier-threshold=<n>] [--checked] [--perf] [--cpu=<cpu>] [--features=<features>] [--cache | --cache-dir=<dir>]"
+              << " [--batch=<file> | --batch-args] [--batch-sep=<sep>] [--batch-time]"
+              << " [-time | --report] [--report-json=<path>]"
+              << " [--pgo-generate=<profile> | --pgo-use=<profile>]"
+              << " [--profile] [--profile-json=<path>]"
+              << " <source> [args...]" << "\n";
     std::exit(-1);
   }
 
   std::string source = args[0];
 
-  // For simplificty, always pass a default arg, as it'll be ignored if not needed.
-  int64_t arg = 0;
-  if (1 < args.size()) {
-    arg = std::stoll(args[1]);
+  Thing thing(source, opt_level);
+  thing.verbosity = verbosity;
+  thing.separator = separator;
+  thing.time_runs = time_runs;
+
+  // Each line of a batch file holds the (whitespace separated) arguments of a run.
+  if (batch_file.has_value()) {
+    auto batch_buffer = llvm::MemoryBuffer::getFileOrSTDIN(batch_file.value());
+    if (!batch_buffer) {
+      std::cout << "Unable to read batch file: " << batch_file.value() << "\n";
+      std::exit(-1);
+    }
+
+    std::istringstream lines((*batch_buffer)->getBuffer().str());
+    std::string line;
+    while (std::getline(lines, line)) {
+      std::istringstream words(line);
+      std::vector<std::string> run_args{};
+      for (std::string word; words >> word;) {
+        run_args.push_back(word);
+      }
+      if (!run_args.empty()) {
+        thing.runs.push_back(run_args);
+      }
+    }
   }
 
-  if (2 < args.size()) {
-    std::cout << "Note: Only zero or one arguments are supported, all others are ignored..." << "\n";
+  // Otherwise, each argument is a run, or all arguments are passed to a single run.
+  else if (batch_args) {
+    for (size_t i = 1; i < args.size(); ++i) {
+      thing.runs.push_back({args[i]});
+    }
   }
 
-  Thing thing(source, arg);
-  thing.verbosity = verbosity;
+  else {
+    thing.runs.push_back(std::vector<std::string>(args.begin() + 1, args.end()));
+  }
 
-  thing.parse();
+  if (report || report_json.has_value()) {
+    thing.enable_report();
+  }
+
+  // Partitions are compiled whole, ahead of execution, so features which require a single module, or lazy compilation, are not supported.
+  if (1 < jobs && (tier_threshold.has_value() || pgo_generate.has_value() || pgo_use.has_value() || cache_dir.has_value())) {
+    std::cout << "--jobs is not supported with --tiered, --pgo-generate, --pgo-use, or --cache" << "\n";
+    std::exit(-1);
+  }
+  thing.jobs = jobs;
 
-  if (print_canonical) {
-    thing.print_canonical();
+  if (tier_threshold.has_value()) {
+    thing.enable_tiering(tier_threshold.value());
   }
 
-  thing.generate_ir();
+  if (checked) {
+    thing.enable_checks();
+  }
+
+  if (perf) {
+    thing.enable_perf();
+  }
 
-  if (print_module) {
-    thing.print_module();
+  if (profile || profile_json.has_value()) {
+    thing.enable_profile();
   }
 
-  thing.verify();
+  if (pgo_generate.has_value()) {
+    thing.enable_pgo_generate(pgo_generate.value());
+  }
+
+  if (pgo_use.has_value()) {
+    thing.enable_pgo_use(pgo_use.value());
+  }
+
+  thing.detect_target(cpu, features);
+
+  // The layout of counters is found when instrumenting, and so instrumented modules are not cached.
+  // Likewise for profile counters, whose sites are found during codegen.
+  // Tiered modules are compiled a fn at a time, by design, and so are not cached either.
+  if (cache_dir.has_value() && !pgo_generate.has_value() && !thing.profile_report && !tier_threshold.has_value()) {
+    thing.enable_cache(cache_dir.value());
+  }
+
+  // On a hit there is no AST or module, so nothing to print.
+  if (!thing.cache_lookup()) {
+    thing.parse();
+
+    if (print_canonical) {
+      thing.print_canonical();
+    }
+
+    thing.generate_ir();
+
+    // The module is printed as generated, before verification, so an invalid module may be inspected.
+    if (print_module) {
+      thing.print_module();
+    }
+
+    thing.verify();
+    thing.rewrite_tiers();
+    thing.instrument_profile();
+    thing.infer_attributes();
+    thing.apply_profile();
+
+    // And again with inferred attributes and any profile, though before optimisation.
+    if (print_module) {
+      thing.print_module("The module, with inferred attributes:");
+    }
+  }
 
   thing.build_execution_engine();
 
-  return thing.execute_main();
+  int exit_code = thing.execute_main();
+
+  thing.stop_tiering();
+
+  thing.write_profile();
+
+  thing.collect_profile();
+  if (thing.profile_report) {
+    if (profile) {
+      std::cout.flush();
+      thing.profile_report->print(std::cerr);
+    }
+
+    if (profile_json.has_value()) {
+      std::error_code ec;
+      llvm::raw_fd_ostream json_out(profile_json.value(), ec);
+      if (ec) {
+        std::cout << "Unable to write profile: " << profile_json.value() << "\n";
+      } else {
+        thing.profile_report->write_json(json_out);
+      }
+    }
+  }
+
+  thing.cache_record();
+
+  if (thing.report) {
+    thing.report->finish();
+
+    if (report) {
+      std::cout.flush();
+      thing.report->print(std::cerr);
+    }
+
+    if (report_json.has_value()) {
+      std::error_code ec;
+      llvm::raw_fd_ostream json_out(report_json.value(), ec);
+      if (ec) {
+        std::cout << "Unable to write report: " << report_json.value() << "\n";
+      } else {
+        thing.report->write_json(json_out);
+      }
+    }
+  }
+
+  return exit_code;
 }
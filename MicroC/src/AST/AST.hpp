@@ -1,14 +1,20 @@
 #pragma once
 
-#include <map>
 #include <string>
+#include <string_view>
 
 #include "llvm/IR/DIBuilder.h"
 
+#include "AST/Arena.hpp"
+#include "AST/Env.hpp"
+#include "AST/Symbols.hpp"
+
 // A general header containing forward declarations for AST nodes, types, and (virtual) base structures.
 // Also, some useful typedefs and related things.
 //
 // See the `Node` subfolder for headers containing specific node declarations.
+//
+// Handles are non-owning pointers to nodes (and types) held in an `Arena`, see `AST/Arena.hpp`.
 
 // Used for codegen
 struct Context;
@@ -36,26 +42,44 @@ struct Void;
 } // namespace Typ
 
 struct TypT;
-typedef std::shared_ptr<TypT> TypHandle;
+typedef TypT *TypHandle;
+
+struct TypTable;
 
+// Types are canonical, made once by a `TypTable`, and so two types are equal exactly when the handles are equal.
 struct TypT {
+private:
+  Typ::Kind _kind;
+
+public:
+  // The representation of this type in the LLVM context of the table which made this type, set by the table.
+  llvm::Type *llvm_typ{nullptr};
+
+  TypT(Typ::Kind kind) : _kind(kind) {}
+
   // Generate the representation of this type.
-  virtual llvm::Type *codegen(Context &ctx) const = 0;
+  // The representation made by the table is used when `ctx` has the LLVM context of the table, and otherwise is rebuilt.
+  // Defined in `codegen/AST/Typ.cpp`.
+  llvm::Type *codegen(Context &ctx) const;
+
+  // Build the representation of this type, without the cached representation of this type.
+  virtual llvm::Type *build(Context &ctx) const = 0;
 
   // The kind of this type, corresponding to a struct.
-  virtual Typ::Kind kind() const = 0;
+  Typ::Kind kind() const { return this->_kind; }
 
   // Whether the kind is of `kind`.
-  bool is_kind(AST::Typ::Kind kind) { return this->kind() == kind; };
+  bool is_kind(AST::Typ::Kind kind) const { return this->_kind == kind; };
 
   // String representation.
   virtual std::string to_string(size_t indent = 0) const = 0;
 
   // Dereference this type, may panic if dereference is not possible.
-  virtual std::shared_ptr<TypT> deref() const = 0;
+  virtual TypHandle deref() const = 0;
 
   // Completes the type, may throw if already complete.
-  virtual TypHandle complete_with(TypHandle d_typ) = 0;
+  // The completed type is found in `types`.
+  virtual TypHandle complete_with(TypTable &types, TypHandle d_typ) const = 0;
 
   // Default vals are LLVM null vals.
   virtual llvm::Constant *defaultgen(Context &ctx) const {
@@ -65,7 +89,7 @@ struct TypT {
   virtual ~TypT() = default;
 };
 
-typedef std::shared_ptr<Typ::Ptr> TypPtrHandle;
+typedef Typ::Ptr *TypPtrHandle;
 
 } // namespace AST
 
@@ -124,13 +148,13 @@ struct Prim1;
 struct Prim2;
 struct Var;
 
-typedef std::shared_ptr<Call> CallHandle;
-typedef std::shared_ptr<Cast> CastHandle;
-typedef std::shared_ptr<CstI> CstIHandle;
-typedef std::shared_ptr<Index> IndexHandle;
-typedef std::shared_ptr<Prim1> Prim1Handle;
-typedef std::shared_ptr<Prim2> Prim2Handle;
-typedef std::shared_ptr<Var> VarHandle;
+typedef Call *CallHandle;
+typedef Cast *CastHandle;
+typedef CstI *CstIHandle;
+typedef Index *IndexHandle;
+typedef Prim1 *Prim1Handle;
+typedef Prim2 *Prim2Handle;
+typedef Var *VarHandle;
 
 // Permitted unary operations
 enum class OpUnary {
@@ -201,7 +225,7 @@ public:
   virtual Expr::Kind kind() const = 0;
 };
 
-typedef std::shared_ptr<ExprT> ExprHandle;
+typedef ExprT *ExprHandle;
 
 // Statements
 
@@ -225,12 +249,12 @@ struct If;
 struct Return;
 struct While;
 
-typedef std::shared_ptr<Block> BlockHandle;
-typedef std::shared_ptr<Declaration> DeclarationHandle;
-typedef std::shared_ptr<Expr> ExprHandle;
-typedef std::shared_ptr<If> IfHandle;
-typedef std::shared_ptr<Return> ReturnHandle;
-typedef std::shared_ptr<While> WhileHandle;
+typedef Block *BlockHandle;
+typedef Declaration *DeclarationHandle;
+typedef Expr *ExprHandle;
+typedef If *IfHandle;
+typedef Return *ReturnHandle;
+typedef While *WhileHandle;
 
 } // namespace Stmt
 
@@ -253,9 +277,12 @@ struct StmtT : NodeT {
   // How many times control may avoid being diverted.
   // E.g. by the absence of an `else` branch of an if.
   virtual size_t pass_throughs() const = 0;
+
+  // The line of source the statement starts on, if known, and otherwise 0.
+  size_t line{0};
 };
 
-typedef std::shared_ptr<StmtT> StmtHandle;
+typedef StmtT *StmtHandle;
 
 // Declarations
 
@@ -270,9 +297,9 @@ struct Var;
 struct Fn;
 struct Prototype;
 
-typedef std::shared_ptr<Var> VarHandle;
-typedef std::shared_ptr<Fn> FnHandle;
-typedef std::shared_ptr<Prototype> PrototypeHandle;
+typedef Var *VarHandle;
+typedef Fn *FnHandle;
+typedef Prototype *PrototypeHandle;
 
 } // namespace Dec
 
@@ -289,10 +316,13 @@ struct DecT : NodeT {
   virtual AST::TypHandle typ() const = 0;
 
   // The variable declared.
-  virtual std::string var() const = 0;
+  virtual std::string_view var() const = 0;
+
+  // The symbol of the variable declared.
+  virtual Symbol symbol() const = 0;
 };
 
-typedef std::shared_ptr<DecT> DecHandle;
+typedef DecT *DecHandle;
 } // namespace AST
 
 // Etc...
@@ -300,35 +330,37 @@ typedef std::shared_ptr<DecT> DecHandle;
 namespace AST {
 
 struct VarTyp {
+  // The symbol of the var.
+  Symbol sym;
+
   // The var.
-  std::string var;
+  std::string_view var;
 
   // The type.
   TypHandle typ;
 
-  VarTyp(std::string var, TypHandle typ) : var(var), typ(typ) {};
+  VarTyp(Symbol sym, std::string_view var, TypHandle typ) : sym(sym), var(var), typ(typ) {};
 
   // To appease bison, should not be used directly.
-  VarTyp() : var("!"), typ(nullptr) {};
+  VarTyp() : sym(NO_SYMBOL), var("!"), typ(nullptr) {};
 };
 
 typedef std::vector<AST::VarTyp> VarTypVec;
 
-typedef std::map<std::string, AST::TypHandle> VarTypMap; // Vars have declared type, fns have return type.
-
 // The (contextual) environment when generating an AST.
 // 'Contextual', here, means the env is mutated with relevant declarations.
 // And, in particular, it is up to the the mutator to restore any temporary mutations (i.e. local declarations)
+// Scopes are entered and exited with the env of vars, see `AST/Env.hpp`.
 struct EnvAST {
 
   // Function declarations.
-  std::map<std::string, AST::Dec::PrototypeHandle> fns{};
+  Env<AST::Dec::PrototypeHandle> fns{};
 
-  // Variables in scope.
-  VarTypMap vars{};
+  // Variables in scope, with declared type.
+  Env<AST::TypHandle> vars{};
 
-  // String representation of the env.
-  std::string to_string();
+  // String representation of the env, with names from `symbols`.
+  std::string to_string(const Symbols &symbols) const;
 };
 
 } // namespace AST
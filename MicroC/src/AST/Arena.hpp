@@ -0,0 +1,51 @@
+#pragma once
+
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "llvm/Support/Allocator.h"
+
+namespace AST {
+
+// Storage for the nodes and types of an AST, with a single arena for each compilation.
+//
+// Nodes are bump allocated in large slabs, and handles to nodes are plain pointers which do not own the node.
+// So, making a node is a pointer bump, passing a handle is a copy of a pointer, and every node is freed at once with the arena.
+// A node lives as long as the arena, and is never freed on its own.
+//
+// Nodes hold strings and vectors, and so the destructor of each node is recorded and run when the arena is destroyed.
+struct Arena {
+  Arena() = default;
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  ~Arena() {
+    for (auto it = this->destructors.rbegin(); it != this->destructors.rend(); ++it) {
+      it->second(it->first);
+    }
+  }
+
+  // Make a `T` in the arena, from `args`.
+  template <typename T, typename... Args>
+  T *make(Args &&...args) {
+    void *memory = this->allocator.Allocate(sizeof(T), alignof(T));
+    T *node = new (memory) T(std::forward<Args>(args)...);
+
+    if constexpr (!std::is_trivially_destructible_v<T>) {
+      this->destructors.push_back({node, [](void *node) { static_cast<T *>(node)->~T(); }});
+    }
+
+    return node;
+  }
+
+  // The bytes allocated for nodes, excluding unused space at the end of each slab.
+  size_t bytes_allocated() const { return this->allocator.getBytesAllocated(); }
+
+private:
+  llvm::BumpPtrAllocator allocator{};
+
+  std::vector<std::pair<void *, void (*)(void *)>> destructors{};
+};
+
+} // namespace AST
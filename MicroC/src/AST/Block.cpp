@@ -2,24 +2,19 @@
 #include "AST/AST.hpp"
 #include "AST/Node/Stmt.hpp"
 
-AST::Block AST::Block::push_DecVar(EnvAST &env, AST::Stmt::DeclarationHandle const &dec_var) {
-  std::string var{dec_var->declaration->var()};
+void AST::Block::push_DecVar(EnvAST &env, AST::Stmt::DeclarationHandle dec_var) {
+  Symbol var = dec_var->declaration->symbol();
 
-  auto shadowed = env.vars.find(var);
-
-  if (shadowed != env.vars.end()) {
+  if (env.vars.contains(var)) {
     this->shadow_vars.push_back(dec_var);
-    this->shadowed_vars.insert(*shadowed);
   } else {
     this->fresh_vars.push_back(dec_var);
   }
 
-  env.vars[var] = dec_var->declaration->typ();
-
-  return *this;
+  env.vars.bind(var, dec_var->declaration->typ());
 }
 
-AST::Block AST::Block::push_Stmt(AST::StmtHandle const &stmt) {
+void AST::Block::push_Stmt(AST::StmtHandle stmt) {
   switch (stmt->kind()) {
 
   case Stmt::Kind::Block: {
@@ -43,7 +38,7 @@ AST::Block AST::Block::push_Stmt(AST::StmtHandle const &stmt) {
   } break;
 
   case Stmt::Kind::If: {
-    auto stmt_if = std::static_pointer_cast<AST::Stmt::If>(stmt);
+    auto stmt_if = static_cast<AST::Stmt::If *>(stmt);
     size_t passed_through = this->pass_throughs;
 
     this->early_returns += stmt_if->stmt_then->early_returns();
@@ -59,7 +54,7 @@ AST::Block AST::Block::push_Stmt(AST::StmtHandle const &stmt) {
   } break;
 
   case Stmt::Kind::While: {
-    auto stmt_while = std::static_pointer_cast<AST::Stmt::While>(stmt);
+    auto stmt_while = static_cast<AST::Stmt::While *>(stmt);
     this->early_returns += stmt_while->body->early_returns();
     this->pass_throughs += stmt_while->body->pass_throughs();
 
@@ -71,24 +66,13 @@ AST::Block AST::Block::push_Stmt(AST::StmtHandle const &stmt) {
   }
 
   this->statements.push_back(stmt);
-
-  return *this;
 }
 
-AST::Block AST::Block::finalize(EnvAST &env) {
-  // Restore shadowed variables to `env`
-  for (auto &shadowed : this->shadowed_vars) {
-    env.vars[shadowed.first] = shadowed.second;
-  }
-
-  // Remove fresh variables from `env`
-  for (auto &fresh : this->fresh_vars) {
-    env.vars.erase(fresh->declaration->var());
-  }
+void AST::Block::finalize(EnvAST &env) {
+  // Unbind fresh variables and restore shadowed variables
+  env.vars.exit();
 
   if (!this->returns) {
     this->pass_throughs += 1;
   }
-
-  return *this;
 }
@@ -10,12 +10,17 @@
   This information is stored in the env(ironment) of a driver.
 
   As variables are scoped, the env must be updated during parsing.
-  To do so, variables are split into 'fresh' and 'shadowed' variants.
-  -  Fresh vars are removed from the env when parsing escapes the block.
-  -  Shadowed vars are replaced in the env by the var which was shadowed, with the shadowed vars stored separately.
+  A scope of the env is entered when parsing enters the block, and each var declared is bound within the scope.
+  Variables are split into 'fresh' and 'shadowed' variants, for codegen.
+  -  Fresh vars are those whose name is not bound when declared.
+  -  Shadowed vars are those whose name is bound when declared.
 
   With this, the env is updated whenever a var is declared, and whenever a block escapes scope.
   Specifically, for bison, a block escapes scope when passed upwards, at which point the `finalize` method should be called.
+
+  A block is built in place, with each push mutating the block, and the block is moved (never copied) by the parser.
+  So, the cost of building a block is linear in the count of statements and declarations.
+  On exit of the scope the env restores both fresh and shadowed vars, see `AST/Env.hpp`.
  */
 namespace AST {
 struct Block {
@@ -35,9 +40,6 @@ struct Block {
   // All non-declaration statements of the block
   std::vector<AST::StmtHandle> statements{};
 
-  // (Temporary) storage of shadowed variables
-  VarTypMap shadowed_vars{};
-
   // How many paths originating in the block *lead* to a return statment
   size_t early_returns{0};
 
@@ -50,15 +52,15 @@ struct Block {
   bool empty() const { return this->statements.empty() && this->fresh_vars.empty() && this->shadow_vars.empty(); };
 
   // Add a declaration, using `env` to determine which variables are in scope.
-  // And, mutates `env` in accordance with the declaration.
-  AST::Block push_DecVar(EnvAST &env, AST::Stmt::DeclarationHandle const &dec_var);
+  // And, binds the declaration in the current scope of `env`.
+  void push_DecVar(EnvAST &env, AST::Stmt::DeclarationHandle dec_var);
 
   // Add a statement.
-  AST::Block push_Stmt(AST::StmtHandle const &stmt);
+  void push_Stmt(AST::StmtHandle stmt);
 
   // To be called after the final declaration / statement has been added to the block.
-  // Of note, restores `env` to its state prior to processing the block.
-  AST::Block finalize(EnvAST &env);
+  // Of note, exits the scope of the block, restoring `env` to its state prior to processing the block.
+  void finalize(EnvAST &env);
 };
 
 } // namespace AST
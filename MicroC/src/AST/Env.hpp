@@ -0,0 +1,131 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "AST/Symbols.hpp"
+
+namespace AST {
+
+// A scoped map from symbols to pointers `V`, with null for a symbol which is not bound.
+//
+// Bindings are held in a flat open-addressing table, probed linearly from the symbol.
+// A slot is kept once made, and a symbol which is no longer bound has a null value, so no binding is ever moved by a lookup or unbind.
+// As only the symbols of a program are bound, the table is bounded by the count of symbols.
+//
+// Scopes are kept with an undo log.
+// Within a scope each bind records the previous value of the symbol, and on exit the log is unwound to the start of the scope.
+// So, exit from a scope restores fresh and shadowed bindings alike, at a cost proportional to the binds of the scope.
+// Binds outside of any scope (i.e. of globals and fns) are not recorded.
+template <typename V>
+struct Env {
+
+  // The value bound to `symbol`, or null.
+  V find(Symbol symbol) const {
+    if (this->slots.empty()) {
+      return nullptr;
+    }
+
+    size_t mask = this->slots.size() - 1;
+    for (size_t index = symbol & mask;; index = (index + 1) & mask) {
+      const Slot &slot = this->slots[index];
+      if (slot.symbol == symbol) {
+        return slot.value;
+      }
+      if (slot.symbol == NO_SYMBOL) {
+        return nullptr;
+      }
+    }
+  }
+
+  // Whether `symbol` is bound.
+  bool contains(Symbol symbol) const { return this->find(symbol) != nullptr; }
+
+  // Bind `symbol` to `value`, shadowing any existing binding until exit from the current scope.
+  void bind(Symbol symbol, V value) {
+    Slot &slot = this->slot(symbol);
+
+    if (!this->scopes.empty()) {
+      this->undo.push_back({symbol, slot.value});
+    }
+
+    slot.value = value;
+  }
+
+  // Start a scope.
+  void enter() { this->scopes.push_back(this->undo.size()); }
+
+  // End the innermost scope, restoring each symbol bound within the scope to its value on entry.
+  void exit() {
+    size_t start = this->scopes.back();
+    this->scopes.pop_back();
+
+    while (this->undo.size() > start) {
+      auto [symbol, value] = this->undo.back();
+      this->undo.pop_back();
+      this->slot(symbol).value = value;
+    }
+  }
+
+  // Call `f` with each bound symbol and value, in no particular order.
+  template <typename F>
+  void for_each(F f) const {
+    for (auto &slot : this->slots) {
+      if (slot.value) {
+        f(slot.symbol, slot.value);
+      }
+    }
+  }
+
+private:
+  struct Slot {
+    Symbol symbol{NO_SYMBOL};
+    V value{nullptr};
+  };
+
+  // A power of two, at most three quarters used.
+  std::vector<Slot> slots{};
+  size_t used{0};
+
+  // Symbols with the value prior to a bind within a scope, and the start of each scope in the log.
+  std::vector<std::pair<Symbol, V>> undo{};
+  std::vector<size_t> scopes{};
+
+  // The slot of `symbol`, made if `symbol` has no slot.
+  Slot &slot(Symbol symbol) {
+    if (4 * (this->used + 1) > 3 * this->slots.size()) {
+      this->grow();
+    }
+
+    size_t mask = this->slots.size() - 1;
+    for (size_t index = symbol & mask;; index = (index + 1) & mask) {
+      Slot &slot = this->slots[index];
+      if (slot.symbol == symbol) {
+        return slot;
+      }
+      if (slot.symbol == NO_SYMBOL) {
+        slot.symbol = symbol;
+        this->used += 1;
+        return slot;
+      }
+    }
+  }
+
+  void grow() {
+    std::vector<Slot> previous(this->slots.empty() ? 16 : 2 * this->slots.size());
+    std::swap(previous, this->slots);
+
+    size_t mask = this->slots.size() - 1;
+    for (auto &slot : previous) {
+      if (slot.symbol != NO_SYMBOL) {
+        size_t index = slot.symbol & mask;
+        while (this->slots[index].symbol != NO_SYMBOL) {
+          index = (index + 1) & mask;
+        }
+        this->slots[index] = slot;
+      }
+    }
+  }
+};
+
+} // namespace AST
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 
 #include "AST/AST.hpp"
 
@@ -17,15 +18,17 @@ enum class Scope {
 
 struct Var : DecT {
 private:
-  std::string id;
+  Symbol sym;
+  std::string_view id;
   TypHandle _typ;
 
 public:
   Scope scope;
 
-  Var(Scope scope, TypHandle typ, std::string name)
+  Var(Scope scope, TypHandle typ, Symbol sym, std::string_view name)
       : scope(scope),
         _typ(typ),
+        sym(sym),
         id(name) {}
 
   // Code generation for a declaration.
@@ -37,7 +40,8 @@ public:
 
   Dec::Kind kind() const override { return Dec::Kind::Var; }
   TypHandle typ() const override { return this->_typ; };
-  std::string var() const override { return this->id; };
+  std::string_view var() const override { return this->id; };
+  Symbol symbol() const override { return this->sym; };
 };
 
 // Prototype
@@ -45,22 +49,28 @@ public:
 struct Prototype : DecT {
 private:
   TypHandle r_typ;
-  std::string id;
+  Symbol sym;
+  std::string_view id;
 
 public:
   VarTypVec args;
 
-  Prototype(TypHandle r_typ, std::string name, VarTypVec args)
+  // The line of source the prototype starts on, if known, and otherwise 0.
+  size_t line{0};
+
+  Prototype(TypHandle r_typ, Symbol sym, std::string_view name, VarTypVec args)
       : r_typ(r_typ),
+        sym(sym),
         id(name),
-        args(args) {}
+        args(std::move(args)) {}
 
   llvm::Value *codegen(Context &ctx) const override;
   std::string to_string(size_t indent = 0) const override;
 
   Dec::Kind kind() const override { return Dec::Kind::Fn; }
   TypHandle typ() const override { return r_typ; };
-  std::string var() const override { return this->id; };
+  std::string_view var() const override { return this->id; };
+  Symbol symbol() const override { return this->sym; };
 
   TypHandle return_type() const { return r_typ; };
 };
@@ -80,7 +90,8 @@ struct Fn : DecT {
 
   Dec::Kind kind() const override { return Dec::Kind::Fn; }
   TypHandle typ() const override { return prototype->return_type(); };
-  std::string var() const override { return this->prototype->var(); };
+  std::string_view var() const override { return this->prototype->var(); };
+  Symbol symbol() const override { return this->prototype->symbol(); };
 
   TypHandle return_type() const { return prototype->return_type(); };
 };
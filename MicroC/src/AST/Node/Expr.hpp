@@ -14,12 +14,14 @@ namespace Expr {
 // Call
 
 struct Call : ExprT {
-  std::string name;
+  Symbol sym;
+  std::string_view name;
   std::vector<ExprHandle> arguments;
 
-  Call(TypHandle return_typ, std::string name, std::vector<ExprHandle> args)
-      : name(name),
-        arguments(args) {
+  Call(TypHandle return_typ, Symbol sym, std::string_view name, std::vector<ExprHandle> args)
+      : sym(sym),
+        name(name),
+        arguments(std::move(args)) {
     this->_typ = return_typ;
   }
 
@@ -120,9 +122,10 @@ struct Prim2 : ExprT {
 };
 
 struct Var : ExprT {
-  std::string var;
+  Symbol sym;
+  std::string_view var;
 
-  Var(TypHandle typ, std::string var) : var(var) {
+  Var(TypHandle typ, Symbol sym, std::string_view var) : sym(sym), var(var) {
     this->_typ = typ;
   }
 
@@ -16,7 +16,7 @@ struct Block : StmtT {
   AST::Block block{};
 
   Block(AST::Block bv)
-      : block(bv) {}
+      : block(std::move(bv)) {}
 
   Stmt::Kind kind() const override { return Stmt::Kind::Block; }
   bool returns() const override { return this->block.returns; };
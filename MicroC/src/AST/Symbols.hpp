@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace AST {
+
+// An interned identifier, given by a `Symbols` table.
+// Two symbols of a table are equal exactly when the identifiers are equal.
+typedef uint32_t Symbol;
+
+// No identifier, as with the default of a slot.
+constexpr Symbol NO_SYMBOL = UINT32_MAX;
+
+// The identifiers of a compilation, each interned to a symbol.
+//
+// Identifiers are interned by the scanner, so each occurrence of an identifier is hashed once, and otherwise identifiers are compared as symbols.
+// Symbols are given in order from zero, and so a symbol may be used as an index, or as its own hash.
+//
+// Names are held with a stable address for the life of the table, and nodes hold a view of the name for IR and printing.
+struct Symbols {
+  Symbols() = default;
+  Symbols(const Symbols &) = delete;
+  Symbols &operator=(const Symbols &) = delete;
+
+  // The symbol of `name`, interning `name` if `name` has not been seen.
+  Symbol intern(std::string_view name) {
+    auto found = this->ids.find(name);
+    if (found != this->ids.end()) {
+      return found->second;
+    }
+
+    Symbol symbol = static_cast<Symbol>(this->names.size());
+    const std::string &held = this->names.emplace_back(name);
+    this->ids.emplace(held, symbol);
+
+    return symbol;
+  }
+
+  // The name of `symbol`, valid for the life of the table.
+  std::string_view name(Symbol symbol) const { return this->names[symbol]; }
+
+  // The count of distinct identifiers.
+  size_t size() const { return this->names.size(); }
+
+private:
+  // A deque, as growth does not move the names viewed by `ids`.
+  std::deque<std::string> names{};
+
+  std::unordered_map<std::string_view, Symbol> ids{};
+};
+
+} // namespace AST
@@ -0,0 +1,31 @@
+#include "AST/TypTable.hpp"
+#include "AST/Types.hpp"
+#include "codegen/Structs.hpp"
+
+template <typename T, typename... Args>
+AST::TypHandle AST::TypTable::make(Args &&...args) {
+  T *typ = this->arena.make<T>(std::forward<Args>(args)...);
+  typ->llvm_typ = typ->build(this->ctx);
+  return typ;
+}
+
+AST::TypTable::TypTable(Arena &arena, Context &ctx)
+    : arena(arena),
+      ctx(ctx),
+      bool_typ(this->make<Typ::Bool>()),
+      char_typ(this->make<Typ::Char>()),
+      int_typ(this->make<Typ::Int>()),
+      void_typ(this->make<Typ::Void>()) {}
+
+AST::TypHandle AST::TypTable::pk_Ptr(TypHandle pointee, std::optional<std::size_t> area) {
+  auto key = std::make_pair(pointee, area);
+
+  auto it = this->ptrs.find(key);
+  if (it != this->ptrs.end()) {
+    return it->second;
+  }
+
+  auto typ = this->make<Typ::Ptr>(pointee, area);
+  this->ptrs[key] = typ;
+  return typ;
+}
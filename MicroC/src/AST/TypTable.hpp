@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <utility>
+
+#include "AST/AST.hpp"
+
+namespace AST {
+
+// The canonical types of a compilation.
+//
+// Each distinct type is made once, in the arena of the compilation, and each request for the type returns the same handle.
+// So, types are compared by handle, and a type is not made for each use (e.g. for each integer literal).
+// Scalar types are made with the table, and pointer types (with and without area) are interned by pointee and area.
+//
+// The LLVM representation of each type is built once, when the type is made, for the LLVM context of the table.
+// Types are made during parsing, so after parsing the table (and each type) is read only, and may be read from many threads.
+struct TypTable {
+  TypTable(Arena &arena, Context &ctx);
+
+  TypTable(const TypTable &) = delete;
+  TypTable &operator=(const TypTable &) = delete;
+
+  TypHandle pk_Bool() const { return this->bool_typ; }
+  TypHandle pk_Char() const { return this->char_typ; }
+  TypHandle pk_Int() const { return this->int_typ; }
+  TypHandle pk_Void() const { return this->void_typ; }
+
+  // A pointer to `pointee`, with `area` if an array.
+  TypHandle pk_Ptr(TypHandle pointee, std::optional<std::size_t> area);
+
+  // The count of distinct types made.
+  size_t size() const { return 4 + this->ptrs.size(); }
+
+private:
+  Arena &arena;
+  Context &ctx;
+
+  TypHandle bool_typ;
+  TypHandle char_typ;
+  TypHandle int_typ;
+  TypHandle void_typ;
+
+  std::map<std::pair<TypHandle, std::optional<std::size_t>>, TypHandle> ptrs{};
+
+  // Make a `T` from `args`, with the LLVM representation of the type.
+  template <typename T, typename... Args>
+  TypHandle make(Args &&...args);
+};
+
+} // namespace AST
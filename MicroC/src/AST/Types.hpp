@@ -3,56 +3,51 @@
 #include <string>
 
 #include "AST/AST.hpp"
+#include "AST/TypTable.hpp"
 #include "codegen/Structs.hpp"
 
 namespace AST {
 
 namespace Typ {
 
-struct Bool : TypT {
-  Typ::Kind kind() const override { return Typ::Kind::Bool; }
+// Types are made by a `TypTable`, see `AST/TypTable.hpp`.
 
-  Bool() {};
+struct Bool : TypT {
+  Bool() : TypT(Typ::Kind::Bool) {};
 
   std::string to_string(size_t indent = 0) const override;
   TypHandle deref() const override { throw std::logic_error("deref called on a bool"); }
 
-  TypHandle complete_with(TypHandle data) override { throw std::logic_error("Complete into bool"); }
+  TypHandle complete_with(TypTable &types, TypHandle data) const override { throw std::logic_error("Complete into bool"); }
 
-  llvm::Type *codegen(Context &ctx) const override { return ctx.get_typ(this->kind()); }
+  llvm::Type *build(Context &ctx) const override { return ctx.get_typ(this->kind()); }
 };
 
 struct Char : TypT {
-  Typ::Kind kind() const override { return Typ::Kind::Char; }
-
-  Char() {};
+  Char() : TypT(Typ::Kind::Char) {};
 
   std::string to_string(size_t indent = 0) const override;
 
   TypHandle deref() const override { throw std::logic_error("deref called on a char"); }
 
-  TypHandle complete_with(TypHandle data) override { throw std::logic_error("Complete into char."); }
+  TypHandle complete_with(TypTable &types, TypHandle data) const override { throw std::logic_error("Complete into char."); }
 
-  llvm::Type *codegen(Context &ctx) const override { return ctx.get_typ(this->kind()); }
+  llvm::Type *build(Context &ctx) const override { return ctx.get_typ(this->kind()); }
 };
 
 struct Int : TypT {
-  Typ::Kind kind() const override { return Typ::Kind::Int; }
-
-  Int() {};
+  Int() : TypT(Typ::Kind::Int) {};
 
   std::string to_string(size_t indent = 0) const override;
 
   TypHandle deref() const override { throw std::logic_error("deref called on an int"); }
 
-  TypHandle complete_with(TypHandle data) override { throw std::logic_error("Complete into int."); }
+  TypHandle complete_with(TypTable &types, TypHandle data) const override { throw std::logic_error("Complete into int."); }
 
-  llvm::Type *codegen(Context &ctx) const override { return ctx.get_typ(this->kind()); }
+  llvm::Type *build(Context &ctx) const override { return ctx.get_typ(this->kind()); }
 };
 
 struct Ptr : TypT {
-  Typ::Kind kind() const override { return Typ::Kind::Ptr; }
-
 private:
   // What's pointed to.
   TypHandle _pointee;
@@ -62,8 +57,9 @@ private:
   std::optional<std::size_t> _area;
 
 public:
-  Ptr(TypHandle typ, std::optional<std::int64_t> area)
-      : _pointee(typ),
+  Ptr(TypHandle typ, std::optional<std::size_t> area)
+      : TypT(Typ::Kind::Ptr),
+        _pointee(typ),
         _area(area) {
   }
 
@@ -72,7 +68,7 @@ public:
   TypHandle pointee_typ() const { return _pointee; }
   std::optional<std::size_t> area() const { return _area; }
 
-  TypHandle complete_with(TypHandle data) override {
+  TypHandle complete_with(TypTable &types, TypHandle data) const override {
 
     switch (this->_pointee->kind()) {
 
@@ -83,28 +79,19 @@ public:
     } break;
 
     case Kind::Ptr: {
-      auto pointee_ptr = std::static_pointer_cast<AST::Typ::Ptr>(this->_pointee);
-
-      auto fresh_destination = this->_pointee->complete_with(data);
-      auto fresh_pointer = Ptr(fresh_destination, this->_area);
-      auto fresh_handle = std::make_shared<AST::Typ::Ptr>(fresh_pointer);
-
-      return fresh_handle;
+      auto fresh_destination = this->_pointee->complete_with(types, data);
+      return types.pk_Ptr(fresh_destination, this->_area);
     } break;
 
     case Kind::Void: {
-
-      auto fresh_pointer = Ptr(data, this->_area);
-      auto fresh_handle = std::make_shared<AST::Typ::Ptr>(fresh_pointer);
-
-      return fresh_handle;
+      return types.pk_Ptr(data, this->_area);
     } break;
     }
   }
 
   TypHandle deref() const override { return _pointee; }
 
-  llvm::Type *codegen(Context &ctx) const override {
+  llvm::Type *build(Context &ctx) const override {
     if (this->_area.has_value()) {
       return llvm::ArrayType::get(this->_pointee->codegen(ctx), this->_area.value());
     } else {
@@ -114,46 +101,17 @@ public:
 };
 
 struct Void : TypT {
-  Typ::Kind kind() const override { return Typ::Kind::Void; }
-
-  Void() {};
+  Void() : TypT(Typ::Kind::Void) {};
 
   std::string to_string(size_t indent = 0) const override;
 
   TypHandle deref() const override { throw std::logic_error("deref() called on void"); }
 
-  TypHandle complete_with(TypHandle data) override { return data; }
+  TypHandle complete_with(TypTable &types, TypHandle data) const override { return data; }
 
-  llvm::Type *codegen(Context &ctx) const override { return ctx.get_typ(this->kind()); }
+  llvm::Type *build(Context &ctx) const override { return ctx.get_typ(this->kind()); }
 };
 
-// pk typ
-
-inline AST::TypHandle pk_Bool() {
-  AST::Typ::Bool typ_bool{};
-  return std::make_shared<AST::Typ::Bool>(typ_bool);
-};
-
-inline AST::TypHandle pk_Char() {
-  AST::Typ::Char typ_char{};
-  return std::make_shared<AST::Typ::Char>(typ_char);
-};
-
-inline AST::TypHandle pk_Int() {
-  AST::Typ::Int typ_int{};
-  return std::make_shared<AST::Typ::Int>(typ_int);
-};
-
-inline AST::TypHandle pk_Ptr(AST::TypHandle typ, std::optional<std::int64_t> area) {
-  AST::Typ::Ptr typ_ptr(typ, area);
-  return std::make_shared<AST::Typ::Ptr>(typ_ptr);
-}
-
-inline AST::TypHandle pk_Void() {
-  AST::Typ::Void typ_void{};
-  return std::make_shared<AST::Typ::Void>(typ_void);
-}
-
 } // namespace Typ
 
 } // namespace AST
@@ -121,7 +121,7 @@ std::string AST::Expr::Prim2::to_string(size_t indent) const {
                      this->lhs->to_string(indent), this->op, this->rhs->to_string(indent));
 }
 
-std::string AST::Expr::Var::to_string(size_t indent) const { return this->var; }
+std::string AST::Expr::Var::to_string(size_t indent) const { return std::string(this->var); }
 
 // Stmt
 
@@ -174,7 +174,7 @@ std::string AST::Stmt::If::to_string(size_t indent) const {
                        this->condition->to_string(indent), this->stmt_then->to_string(indent));
 
   if (this->stmt_else->kind() == AST::Stmt::Kind::Block) {
-    auto as_block = std::static_pointer_cast<AST::Stmt::Block>(this->stmt_else);
+    auto as_block = static_cast<AST::Stmt::Block *>(this->stmt_else);
     if (as_block->block.empty()) {
       goto complete_if_string;
     }
@@ -210,15 +210,15 @@ std::string AST::Stmt::While::to_string(size_t indent) const {
 
 // Env
 
-std::string AST::EnvAST::to_string() {
+std::string AST::EnvAST::to_string(const Symbols &symbols) const {
   std::stringstream ss{};
   ss << "Env AST:" << "\n";
-  for (auto &var : vars) {
-    ss << "\t" << var.first << " : " << var.second->to_string() << "\n";
-  }
-  for (auto &fn : fns) {
-    ss << "\t" << fn.first << " : " << " ..." << "\n";
-  }
+  vars.for_each([&](Symbol var, TypHandle typ) {
+    ss << "\t" << symbols.name(var) << " : " << typ->to_string() << "\n";
+  });
+  fns.for_each([&](Symbol fn, Dec::PrototypeHandle prototype) {
+    ss << "\t" << symbols.name(fn) << " : " << " ..." << "\n";
+  });
 
   return ss.str();
 }
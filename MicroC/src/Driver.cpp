@@ -1,3 +1,6 @@
+#include <exception>
+#include <thread>
+
 #include "Driver.hpp"
 
 #include "AST/AST.hpp"
@@ -7,22 +10,131 @@
 #include "AST/Types.hpp"
 #include "codegen/Structs.hpp"
 
+// The name of each kind of node, in the order of `Driver::NodeKind`.
+static constexpr std::array<const char *, static_cast<size_t>(Driver::NodeKind::Count)> NODE_KIND_NAMES{
+    "Dec::Fn",
+    "Dec::Prototype",
+    "Dec::Var",
+    "Expr::Call",
+    "Expr::Cast",
+    "Expr::CstI",
+    "Expr::Index",
+    "Expr::Prim1",
+    "Expr::Prim2",
+    "Expr::Var",
+    "Stmt::Block",
+    "Stmt::Declaration",
+    "Stmt::Expr",
+    "Stmt::If",
+    "Stmt::Return",
+    "Stmt::While",
+};
+
+std::map<std::string, size_t> Driver::node_counts_by_name() const {
+  std::map<std::string, size_t> counts{};
+
+  for (size_t kind = 0; kind < this->node_counts.size(); ++kind) {
+    if (this->node_counts[kind] != 0) {
+      counts[NODE_KIND_NAMES[kind]] = this->node_counts[kind];
+    }
+  }
+
+  return counts;
+}
+
 void Driver::generate_ir() {
+  if (ctx.options.debug_info) {
+    ctx.enable_debug_info(src_file);
+  }
+
   for (auto &dec : prg) {
     dec->codegen(ctx);
   }
+
+  ctx.finalize_debug_info();
+  ctx.finalize_profile_counters();
 };
 
+void Driver::generate_ir_partitioned(size_t count) {
+  this->partitions.clear();
+
+  for (size_t index = 1; index < count; ++index) {
+    auto partition = std::make_unique<Context>();
+    partition->module->setModuleIdentifier(std::format("microC.{}", index));
+    partition->module->setTargetTriple(this->ctx.module->getTargetTriple());
+    partition->module->setDataLayout(this->ctx.module->getDataLayout());
+    // Nodes are shared, and so the env of a partition has the symbols of `ctx`.
+    partition->env_ast = this->ctx.env_ast;
+    partition->options = this->ctx.options;
+    partition->define_globals = false;
+    partition->profile_counters_name = std::format("{}.{}", this->ctx.profile_counters_name, index);
+
+    this->partitions.push_back(std::move(partition));
+  }
+
+  // Errors are rethrown on this thread, as for sequential codegen.
+  std::vector<std::exception_ptr> errors(count, nullptr);
+  std::vector<std::thread> threads{};
+
+  for (size_t index = 0; index < count; ++index) {
+    Context &partition = index == 0 ? this->ctx : *this->partitions[index - 1];
+
+    threads.emplace_back([this, &partition, &errors, index, count]() {
+      try {
+        this->generate_partition(partition, index, count);
+      } catch (...) {
+        errors[index] = std::current_exception();
+      }
+    });
+  }
+
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+void Driver::generate_partition(Context &partition, size_t index, size_t count) const {
+  if (partition.options.debug_info) {
+    partition.enable_debug_info(this->src_file);
+  }
+
+  size_t fn_index = 0;
+
+  for (auto &dec : this->prg) {
+    auto fn = dynamic_cast<AST::Dec::Fn *>(dec->declaration);
+
+    if (fn && fn_index++ % count != index) {
+      fn->prototype->codegen(partition);
+    } else {
+      dec->codegen(partition);
+    }
+  }
+
+  partition.finalize_debug_info();
+  partition.finalize_profile_counters();
+}
+
 int Driver::parse(const std::string &file) {
+  auto source = Source::from_file(file);
+  return this->parse(*source, file);
+}
+
+int Driver::parse(Source &source, const std::string &name) {
 
-  // Ensure a fresh env.
-  assert(this->ctx.env_ast.vars.empty());
+  // Ensure a fresh env, as globals are only bound by a parse.
+  assert(this->prg.empty());
 
-  src_file = file;
+  src_file = name;
   location.initialize(&src_file);
   int res;
 
-  scan_begin();
+  scan_begin(source);
   yy::parser parse(*this);
   parse.set_debug_level(trace_parsing);
   res = parse();
@@ -107,52 +219,55 @@ AST::Expr::OpUnary Driver::to_unary_op(std::string op) {
 // This motivation is extended to vars to form a rule.
 
 AST::Dec::FnHandle Driver::pk_DecFn(AST::Dec::PrototypeHandle prototype, AST::Stmt::BlockHandle body) {
-  if (!this->ctx.env_ast.fns.contains(prototype->var())) {
+  this->count_node(NodeKind::DecFn);
+  if (!this->ctx.env_ast.fns.contains(prototype->symbol())) {
     throw std::logic_error(std::format("Missing prototype for {}", prototype->var()));
   }
 
-  AST::Dec::Fn dec(prototype, body);
-  return std::make_shared<AST::Dec::Fn>(dec);
+  return this->ctx.arena.make<AST::Dec::Fn>(prototype, body);
 }
 
-AST::Dec::PrototypeHandle Driver::pk_Prototype(AST::TypHandle r_typ, std::string var, AST::VarTypVec args) {
-  if (this->ctx.env_ast.fns.find(var) != this->ctx.env_ast.fns.end()) {
-    throw std::logic_error(std::format("Existing prototype for: {}.", var));
+AST::Dec::PrototypeHandle Driver::pk_Prototype(AST::TypHandle r_typ, AST::Symbol var, AST::VarTypVec args) {
+  this->count_node(NodeKind::DecPrototype);
+  auto name = this->ctx.symbols.name(var);
+  if (this->ctx.env_ast.fns.contains(var)) {
+    throw std::logic_error(std::format("Existing prototype for: {}.", name));
   }
 
-  AST::Dec::Prototype prototype(r_typ, var, args);
-  auto pt_ptr = std::make_shared<AST::Dec::Prototype>(prototype);
-  this->ctx.env_ast.fns[var] = pt_ptr;
+  auto prototype = this->ctx.arena.make<AST::Dec::Prototype>(r_typ, var, name, std::move(args));
+  this->ctx.env_ast.fns.bind(var, prototype);
 
-  return pt_ptr;
+  return prototype;
 }
 
-AST::Dec::VarHandle Driver::pk_DecVar(AST::Dec::Scope scope, AST::TypHandle typ, std::string var) {
+AST::Dec::VarHandle Driver::pk_DecVar(AST::Dec::Scope scope, AST::TypHandle typ, AST::Symbol var) {
+  this->count_node(NodeKind::DecVar);
+  auto name = this->ctx.symbols.name(var);
   if (scope == AST::Dec::Scope::Global) {
-    if (this->ctx.env_ast.vars.find(var) != this->ctx.env_ast.vars.end()) {
-      throw std::logic_error(std::format("Redeclaration of global: {}", var));
+    if (this->ctx.env_ast.vars.contains(var)) {
+      throw std::logic_error(std::format("Redeclaration of global: {}", name));
     }
 
-    this->ctx.env_ast.vars[var] = typ;
+    this->ctx.env_ast.vars.bind(var, typ);
   }
 
-  AST::Dec::Var dec(scope, typ, var);
-  return std::make_shared<AST::Dec::Var>(dec);
+  return this->ctx.arena.make<AST::Dec::Var>(scope, typ, var, name);
 }
 
 // Pointer make methods for expressions
 
-AST::Expr::CallHandle Driver::pk_ExprCall(std::string var, std::vector<AST::ExprHandle> args) {
+AST::Expr::CallHandle Driver::pk_ExprCall(AST::Symbol var, std::vector<AST::ExprHandle> args) {
+  this->count_node(NodeKind::ExprCall);
+  auto name = this->ctx.symbols.name(var);
 
-  auto prototype_find = this->ctx.env_ast.fns.find(var);
-  if (prototype_find == this->ctx.env_ast.fns.end()) {
-    throw std::logic_error(std::format("Call without prototype: {}", var));
+  auto prototype = this->ctx.env_ast.fns.find(var);
+  if (!prototype) {
+    throw std::logic_error(std::format("Call without prototype: {}", name));
   }
-  auto prototype = prototype_find->second;
 
   if (args.size() != prototype->args.size()) {
     throw std::logic_error(std::format("Call to '{}' expected {} args, found {}",
-                                       var,
+                                       name,
                                        prototype->args.size(),
                                        args.size()));
   }
@@ -171,98 +286,100 @@ AST::Expr::CallHandle Driver::pk_ExprCall(std::string var, std::vector<AST::Expr
     }
   }
 
-  AST::Expr::Call call(prototype->return_type(), var, args);
-
-  return std::make_shared<AST::Expr::Call>(call);
+  return this->ctx.arena.make<AST::Expr::Call>(prototype->return_type(), var, name, std::move(args));
 }
 
 AST::Expr::CastHandle Driver::pk_ExprCast(AST::ExprHandle expr, AST::TypHandle to) {
+  this->count_node(NodeKind::ExprCast);
 
-  AST::Expr::Cast cast(expr, to);
-  return std::make_shared<AST::Expr::Cast>(cast);
+  return this->ctx.arena.make<AST::Expr::Cast>(expr, to);
 }
 
-AST::Expr::CallHandle Driver::pk_ExprCall(std::string name, AST::ExprHandle arg) {
+AST::Expr::CallHandle Driver::pk_ExprCall(AST::Symbol name, AST::ExprHandle arg) {
 
   std::vector<AST::ExprHandle> args = std::vector<AST::ExprHandle>{arg};
-  return this->pk_ExprCall(name, args);
+  return this->pk_ExprCall(name, std::move(args));
 }
 
-AST::Expr::CallHandle Driver::pk_ExprCall(std::string name) {
+AST::Expr::CallHandle Driver::pk_ExprCall(AST::Symbol name) {
 
   std::vector<AST::ExprHandle> empty_args = std::vector<AST::ExprHandle>{};
-  return this->pk_ExprCall(name, empty_args);
+  return this->pk_ExprCall(name, std::move(empty_args));
 }
 
 AST::Expr::CstIHandle Driver::pk_ExprCstI(std::int64_t i) {
-  auto typ = AST::Typ::pk_Int();
-  AST::Expr::CstI csti(typ, i);
-
-  return std::make_shared<AST::Expr::CstI>(csti);
+  this->count_node(NodeKind::ExprCstI);
+  auto typ = this->ctx.types.pk_Int();
+  return this->ctx.arena.make<AST::Expr::CstI>(typ, i);
 }
 
 AST::Expr::IndexHandle Driver::pk_ExprIndex(AST::ExprHandle access, AST::ExprHandle index) {
+  this->count_node(NodeKind::ExprIndex);
 
-  AST::Expr::Index idx(access, index);
-  return std::make_shared<AST::Expr::Index>(idx);
+  return this->ctx.arena.make<AST::Expr::Index>(access, index);
 }
 
 AST::Expr::Prim1Handle Driver::pk_ExprPrim1(AST::Expr::OpUnary op, AST::ExprHandle expr) {
+  this->count_node(NodeKind::ExprPrim1);
 
   auto typ = this->typ_resolution_prim1(op, expr);
-  AST::Expr::Prim1 prim1(typ, op, expr);
-
-  return std::make_shared<AST::Expr::Prim1>(prim1);
+  return this->ctx.arena.make<AST::Expr::Prim1>(typ, op, expr);
 }
 
 AST::Expr::Prim2Handle Driver::pk_ExprPrim2(AST::Expr::OpBinary op, AST::ExprHandle lhs, AST::ExprHandle rhs) {
+  this->count_node(NodeKind::ExprPrim2);
+
+  // As in C, a condition may be assigned to an int.
+  if (op == AST::Expr::OpBinary::Assign &&
+      lhs->typ_has_kind(AST::Typ::Kind::Int) && rhs->typ_has_kind(AST::Typ::Kind::Bool)) {
+    rhs = pk_ExprCast(rhs, lhs->typ());
+  }
 
   auto typ = this->typ_resolution_prim2(op, lhs, rhs);
-  AST::Expr::Prim2 prim2(typ, op, lhs, rhs);
-  return std::make_shared<AST::Expr::Prim2>(prim2);
+  return this->ctx.arena.make<AST::Expr::Prim2>(typ, op, lhs, rhs);
 }
 
-AST::Expr::VarHandle Driver::pk_ExprVar(std::string var) {
-  auto env_var = this->ctx.env_ast.vars.find(var);
+AST::Expr::VarHandle Driver::pk_ExprVar(AST::Symbol var) {
+  this->count_node(NodeKind::ExprVar);
+  auto typ = this->ctx.env_ast.vars.find(var);
 
-  if (env_var == this->ctx.env_ast.vars.end()) {
-    throw std::logic_error(std::format("Unknown variable: {}", var));
+  if (!typ) {
+    throw std::logic_error(std::format("Unknown variable: {}", this->ctx.symbols.name(var)));
   }
 
-  auto typ = env_var->second;
-  AST::Expr::Var access(typ, var);
-  return std::make_shared<AST::Expr::Var>(access);
+  return this->ctx.arena.make<AST::Expr::Var>(typ, var, this->ctx.symbols.name(var));
 }
 
 // Pointer make methods for statements
 
 AST::Stmt::BlockHandle Driver::pk_StmtBlock(AST::Block block) {
-  AST::Stmt::Block stmt(block);
-  return std::make_shared<AST::Stmt::Block>(stmt);
+  this->count_node(NodeKind::StmtBlock);
+  return this->ctx.arena.make<AST::Stmt::Block>(std::move(block));
 }
 
 AST::Stmt::BlockHandle Driver::pk_StmtBlockStmt(AST::Block block) {
-  AST::Stmt::Block stmt(block);
-  return std::make_shared<AST::Stmt::Block>(stmt);
+  this->count_node(NodeKind::StmtBlock);
+  return this->ctx.arena.make<AST::Stmt::Block>(std::move(block));
 }
 
 AST::Stmt::DeclarationHandle Driver::pk_StmtDeclaration(AST::DecHandle declaration) {
-  AST::Stmt::Declaration stmt(declaration);
-  return std::make_shared<AST::Stmt::Declaration>(stmt);
+  this->count_node(NodeKind::StmtDeclaration);
+  return this->ctx.arena.make<AST::Stmt::Declaration>(declaration);
 }
 
 AST::Stmt::ExprHandle Driver::pk_StmtExpr(AST::ExprHandle expr) {
-  AST::Stmt::Expr stmt(expr);
-  return std::make_shared<AST::Stmt::Expr>(stmt);
+  this->count_node(NodeKind::StmtExpr);
+  return this->ctx.arena.make<AST::Stmt::Expr>(expr);
 }
 
 AST::Stmt::IfHandle Driver::pk_StmtIf(AST::ExprHandle condition, AST::StmtHandle thn, AST::StmtHandle els) {
+  this->count_node(NodeKind::StmtIf);
 
   AST::Stmt::BlockHandle block_then;
   AST::Stmt::BlockHandle block_else;
 
   if (thn->kind() == AST::Stmt::Kind::Block) {
-    block_then = std::static_pointer_cast<AST::Stmt::Block>(thn);
+    block_then = static_cast<AST::Stmt::Block *>(thn);
   } else {
     auto fresh_block = AST::Block();
     fresh_block.push_Stmt(thn);
@@ -270,19 +387,18 @@ AST::Stmt::IfHandle Driver::pk_StmtIf(AST::ExprHandle condition, AST::StmtHandle
   }
 
   if (els->kind() == AST::Stmt::Kind::Block) {
-    block_else = std::static_pointer_cast<AST::Stmt::Block>(els);
+    block_else = static_cast<AST::Stmt::Block *>(els);
   } else {
     auto fresh_block = AST::Block();
     fresh_block.push_Stmt(els);
     block_else = Driver::pk_StmtBlock(fresh_block);
   }
 
-  AST::Stmt::If stmt(condition, block_then, block_else);
-
-  return std::make_shared<AST::Stmt::If>(stmt);
+  return this->ctx.arena.make<AST::Stmt::If>(condition, block_then, block_else);
 }
 
 AST::Stmt::ReturnHandle Driver::pk_StmtReturn(std::optional<AST::ExprHandle> value) {
+  this->count_node(NodeKind::StmtReturn);
 
   // TODO: Generalise implementation
   // The book ensures all expressions return ints.
@@ -291,20 +407,17 @@ AST::Stmt::ReturnHandle Driver::pk_StmtReturn(std::optional<AST::ExprHandle> val
   // See, e.g., how returns are handled during codegen.
   if (value.has_value()) {
     if (value.value()->typ_has_kind(AST::Typ::Kind::Bool)) {
-      auto cast = pk_ExprCast(value.value(), AST::Typ::pk_Int());
-      AST::Stmt::Return stmt(cast);
-      return std::make_shared<AST::Stmt::Return>(stmt);
+      auto cast = pk_ExprCast(value.value(), this->ctx.types.pk_Int());
+      return this->ctx.arena.make<AST::Stmt::Return>(cast);
     }
   }
 
-  AST::Stmt::Return stmt(value);
-
-  return std::make_shared<AST::Stmt::Return>(stmt);
+  return this->ctx.arena.make<AST::Stmt::Return>(value);
 }
 
 AST::Stmt::WhileHandle Driver::pk_StmtWhile(AST::ExprHandle condition, AST::StmtHandle block) {
-  AST::Stmt::While stmt(condition, block);
-  return std::make_shared<AST::Stmt::While>(stmt);
+  this->count_node(NodeKind::StmtWhile);
+  return this->ctx.arena.make<AST::Stmt::While>(condition, block);
 }
 
 // pk end
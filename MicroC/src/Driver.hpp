@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <map>
 #include <optional>
 #include <string>
 #include <vector>
@@ -9,27 +11,68 @@
 #include "AST/Node/Dec.hpp"
 #include "AST/Node/Expr.hpp"
 #include "AST/Types.hpp"
+#include "Source.hpp"
 #include "codegen/Structs.hpp"
 
 #include "parser.hpp"
 
+// The (reentrant) scanner state, as declared by flex.
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
+
 // Give flex the prototype of yylex
-#define YY_DECL yy::parser::symbol_type yylex(Driver &drv)
-YY_DECL; // Declare the prototype for bison
+#define YY_DECL yy::parser::symbol_type yylex(Driver &drv, yyscan_t yyscanner)
+YY_DECL;
 
 struct Driver {
   // The program, as ordered declarations.
   std::vector<AST::Stmt::DeclarationHandle> prg{};
 
-  // Temporary storage for shadowed globals during parsing
-  AST::VarTypMap shadow_cache{};
+  // Kinds of AST node made by the driver, as counted.
+  enum class NodeKind : size_t {
+    DecFn,
+    DecPrototype,
+    DecVar,
+    ExprCall,
+    ExprCast,
+    ExprCstI,
+    ExprIndex,
+    ExprPrim1,
+    ExprPrim2,
+    ExprVar,
+    StmtBlock,
+    StmtDeclaration,
+    StmtExpr,
+    StmtIf,
+    StmtReturn,
+    StmtWhile,
+    Count,
+  };
+
+  // Counts of AST nodes made, indexed by kind.
+  std::array<size_t, static_cast<size_t>(NodeKind::Count)> node_counts{};
+
+  // Counts of AST nodes made, by the name of the kind (e.g. "Expr::Call"), omitting kinds with no nodes.
+  std::map<std::string, size_t> node_counts_by_name() const;
 
   // Things useful for LLVM codegen.
   Context ctx{};
 
+  // With partitioned codegen, the partitions other than `ctx`.
+  std::vector<std::unique_ptr<Context>> partitions{};
+
   // The file to be parsed.
   std::string src_file;
 
+  // The scanner of a parse, between `scan_begin` and `scan_end`.
+  // All state of a parse is held by the driver (and parser), so drivers may parse concurrently.
+  yyscan_t scanner{nullptr};
+
+  // The text of a string literal, while scanned.
+  std::string str_buf{};
+
   bool trace_parsing;
   bool trace_scanning;
 
@@ -41,17 +84,37 @@ struct Driver {
         trace_scanning(false),
         ctx(Context{}) {}
 
+  // A parse which throws does not reach `scan_end`, and so the scanner is freed here.
+  ~Driver() { this->scan_end(); }
+
   void generate_ir();
+
+  // Codegen split over `count` partitions, generated concurrently, with `ctx` the first and `partitions` the others.
+  //
+  // Each partition has a context and module of its own, with the target of `ctx`.
+  // Fns are defined in a single partition and declared in the others, while globals are defined in the first partition.
+  // So, once prototypes are known (i.e. after parsing), the body of each fn is independent of the bodies of other fns.
+  void generate_ir_partitioned(size_t count);
   void print_llvm();
 
+  // Codegen of partition `index` of `count`, with fns assigned to partitions in turn.
+  void generate_partition(Context &partition, size_t index, size_t count) const;
+
   // Run the parser on file; return 0 on success.
   int parse(const std::string &file);
 
+  // Run the parser on `source`, with `name` the file of locations; return 0 on success.
+  // The source is only read during the parse, and may be freed after.
+  int parse(Source &source, const std::string &name);
+
+  // Count a node of `kind`.
+  void count_node(NodeKind kind) { this->node_counts[static_cast<size_t>(kind)] += 1; }
+
   // Push a declaration to the AST representation of the program.
   void push_dec(AST::Stmt::DeclarationHandle stmt);
 
-  // Handling the scanner.
-  void scan_begin();
+  // Handling the scanner, which scans `source` in place.
+  void scan_begin(Source &source);
   void scan_end();
 
   // Retrun a string representation of the parsed program in 'canonical' form.
@@ -60,27 +123,18 @@ struct Driver {
 
   // etc
 
+  // Enter the scope of a fn, with each arg bound.
   void add_to_env(AST::VarTypVec &args) {
-    for (auto &arg : args) {
-      auto existing_global = this->ctx.env_ast.vars.find(arg.var);
-      if (existing_global != this->ctx.env_ast.vars.end()) {
-        this->shadow_cache[existing_global->first] = existing_global->second;
-      }
+    this->ctx.env_ast.vars.enter();
 
-      this->ctx.env_ast.vars[arg.var] = arg.typ;
+    for (auto &arg : args) {
+      this->ctx.env_ast.vars.bind(arg.sym, arg.typ);
     }
   }
 
-  void fn_finalise(AST::Dec::FnHandle fn) {
-    for (auto &arg : fn->prototype->args) {
-      this->ctx.env_ast.vars.erase(arg.var);
-    }
-
-    for (auto &shadowed : this->shadow_cache) {
-      this->ctx.env_ast.vars[shadowed.first] = shadowed.second;
-    }
-
-    this->shadow_cache.clear();
+  // Exit the scope of a fn, restoring any globals shadowed by args.
+  void fn_finalise() {
+    this->ctx.env_ast.vars.exit();
   }
 
   // representation
@@ -96,7 +150,7 @@ struct Driver {
     switch (op) {
 
     case AST::Expr::OpUnary::AddressOf: {
-      return AST::Typ::pk_Ptr(expr->typ(), std::nullopt);
+      return this->ctx.types.pk_Ptr(expr->typ(), std::nullopt);
     } break;
 
     case AST::Expr::OpUnary::Dereference: {
@@ -109,11 +163,11 @@ struct Driver {
     } break;
 
     case AST::Expr::OpUnary::Sub: {
-      return AST::Typ::pk_Int();
+      return this->ctx.types.pk_Int();
     } break;
 
     case AST::Expr::OpUnary::Negation: {
-      return AST::Typ::pk_Bool();
+      return this->ctx.types.pk_Bool();
     } break;
     }
   }
@@ -123,7 +177,7 @@ struct Driver {
     // TODO: Unify this pattern, it likely appears elsewhere
     auto rhs_typ = rhs->typ();
     if (rhs->kind() == AST::Expr::Kind::Index) {
-      auto as_index = std::static_pointer_cast<AST::Expr::Index>(rhs);
+      auto as_index = static_cast<AST::Expr::Index *>(rhs);
       rhs_typ = as_index->target->typ()->deref();
     }
 
@@ -176,15 +230,30 @@ struct Driver {
 
     switch (op) {
 
-    case AST::Expr::OpBinary::Assign:
+    case AST::Expr::OpBinary::Assign: {
+      type_ensure_assignment(lhs, rhs);
+
+      return rhs->typ();
+    } break;
+
+    // Compound assignments have the type of the destination.
+    // Pointers (without area) support `+=` and `-=` with an int, as pointer arithmetic.
     case AST::Expr::OpBinary::AssignAdd:
     case AST::Expr::OpBinary::AssignSub:
     case AST::Expr::OpBinary::AssignMul:
     case AST::Expr::OpBinary::AssignDiv:
     case AST::Expr::OpBinary::AssignMod: {
-      type_ensure_assignment(lhs, rhs);
+      if (lhs->typ_has_kind(AST::Typ::Kind::Int) && rhs->typ_has_kind(AST::Typ::Kind::Int)) {
+        return lhs->typ();
+      }
 
-      return rhs->typ();
+      if ((op == AST::Expr::OpBinary::AssignAdd || op == AST::Expr::OpBinary::AssignSub) &&
+          lhs->typ_has_kind(AST::Typ::Kind::Ptr) && rhs->typ_has_kind(AST::Typ::Kind::Int) &&
+          !static_cast<AST::Typ::Ptr *>(lhs->typ())->area().has_value()) {
+        return lhs->typ();
+      }
+
+      return type_unsupported_binary_op(op, lhs, rhs);
     } break;
 
     case AST::Expr::OpBinary::Add:
@@ -202,7 +271,7 @@ struct Driver {
         } break;
 
         case AST::Typ::Kind::Int: {
-          return AST::Typ::pk_Int();
+          return this->ctx.types.pk_Int();
         } break;
 
         case AST::Typ::Kind::Ptr:
@@ -236,17 +305,25 @@ struct Driver {
     case AST::Expr::OpBinary::Geq: {
       type_ensure_match(lhs, rhs);
 
-      return AST::Typ::pk_Bool();
+      return this->ctx.types.pk_Bool();
     } break;
 
     case AST::Expr::OpBinary::And:
     case AST::Expr::OpBinary::Or: {
 
-      return AST::Typ::pk_Bool();
+      return this->ctx.types.pk_Bool();
     } break;
     }
   }
 
+  // Sets the line of `node`, a statement or prototype, to the first line of `location`, and returns `node`.
+  // Used by the parser, with the location of a rule.
+  template <typename Handle>
+  Handle located(Handle node, const yy::location &location) {
+    node->line = location.begin.line;
+    return node;
+  }
+
   // pk start
 
   // Methods for creating nodes.
@@ -259,19 +336,19 @@ struct Driver {
   AST::Dec::FnHandle pk_DecFn(AST::Dec::PrototypeHandle prototype, AST::Stmt::BlockHandle body);
 
   // Prototypes require specification of return type, var, and arguments (as type var pairs).
-  AST::Dec::PrototypeHandle pk_Prototype(AST::TypHandle r_typ, std::string var, AST::VarTypVec args);
+  AST::Dec::PrototypeHandle pk_Prototype(AST::TypHandle r_typ, AST::Symbol var, AST::VarTypVec args);
 
   // Variable declaration requires specification scope, typ, and var of the variable.
-  AST::Dec::VarHandle pk_DecVar(AST::Dec::Scope scope, AST::TypHandle typ, std::string var);
+  AST::Dec::VarHandle pk_DecVar(AST::Dec::Scope scope, AST::TypHandle typ, AST::Symbol var);
 
   // pk Expr
 
   // Calls requires the var of the fn and arguments.
   // An error is thrown if no prototype is found, or if arguments are incorrect.
   // Overloads are provided for convenience.
-  AST::Expr::CallHandle pk_ExprCall(std::string name, std::vector<AST::ExprHandle> args);
-  AST::Expr::CallHandle pk_ExprCall(std::string name, AST::ExprHandle arg);
-  AST::Expr::CallHandle pk_ExprCall(std::string name);
+  AST::Expr::CallHandle pk_ExprCall(AST::Symbol name, std::vector<AST::ExprHandle> args);
+  AST::Expr::CallHandle pk_ExprCall(AST::Symbol name, AST::ExprHandle arg);
+  AST::Expr::CallHandle pk_ExprCall(AST::Symbol name);
 
   // Casts require the expression cast and the target type.
   AST::Expr::CastHandle pk_ExprCast(AST::ExprHandle expr, AST::TypHandle to);
@@ -286,7 +363,7 @@ struct Driver {
 
   AST::Expr::Prim2Handle pk_ExprPrim2(AST::Expr::OpBinary op, AST::ExprHandle a, AST::ExprHandle b);
 
-  AST::Expr::VarHandle pk_ExprVar(std::string var);
+  AST::Expr::VarHandle pk_ExprVar(AST::Symbol var);
 
   // pk Stmt
 
@@ -306,3 +383,6 @@ struct Driver {
 
   // pk end
 };
+
+// The parser calls yylex with the driver, which holds the scanner.
+inline yy::parser::symbol_type yylex(Driver &drv) { return yylex(drv, drv.scanner); }
@@ -0,0 +1,82 @@
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Source.hpp"
+
+// Files smaller than this are read, as a map has a fixed cost which outweighs a copy of a small file.
+static constexpr size_t MAP_THRESHOLD = 16 * 1024;
+
+Source::~Source() {
+  if (this->mapped) {
+    munmap(this->mapped, this->mapped_size);
+  }
+}
+
+std::unique_ptr<Source> Source::from_text(std::string text) {
+  auto source = std::unique_ptr<Source>(new Source());
+
+  source->_size = text.size();
+  source->text = std::move(text);
+  source->text.append(2, '\0');
+
+  return source;
+}
+
+std::unique_ptr<Source> Source::from_file(const std::string &file) {
+  if (file.empty() || file == "-") {
+    std::string text(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>{});
+    return Source::from_text(std::move(text));
+  }
+
+  int fd = open(file.c_str(), O_RDONLY);
+  struct stat file_stat{};
+
+  if (fd < 0 || fstat(fd, &file_stat) != 0) {
+    std::cerr << "Unable to open " << file << ": " << strerror(errno) << '\n';
+    std::exit(EXIT_FAILURE);
+  }
+
+  size_t size = file_stat.st_size;
+  size_t page = sysconf(_SC_PAGESIZE);
+
+  // Bytes of the last page past the end of the file are mapped as zero, and so the map may be scanned if there are at least two.
+  if (MAP_THRESHOLD <= size && size % page != 0 && size % page <= page - 2) {
+    void *mapped = mmap(nullptr, size + 2, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+
+    if (mapped != MAP_FAILED) {
+      close(fd);
+
+      auto source = std::unique_ptr<Source>(new Source());
+      source->mapped = static_cast<char *>(mapped);
+      source->mapped_size = size + 2;
+      source->_size = size;
+
+      return source;
+    }
+  }
+
+  std::string text(size, '\0');
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = read(fd, text.data() + done, size - done);
+    if (n < 0) {
+      std::cerr << "Unable to read " << file << ": " << strerror(errno) << '\n';
+      std::exit(EXIT_FAILURE);
+    } else if (n == 0) {
+      break;
+    }
+    done += n;
+  }
+  text.resize(done);
+  close(fd);
+
+  return Source::from_text(std::move(text));
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+// The text of a source, held in a buffer which the scanner reads in place (see `yy_scan_buffer`).
+//
+// Flex writes to the buffer while scanning, and requires the buffer to end with two null bytes.
+// So, large files are mapped privately (writes are not written to the file), with the nulls from the zeroed end of the last page.
+// Other sources (small files, stdin, and text held in memory) are held in a string, with the nulls appended.
+struct Source {
+  Source(const Source &) = delete;
+  Source &operator=(const Source &) = delete;
+
+  ~Source();
+
+  // The source in `file`, or stdin if `file` is empty or "-".
+  // Exits if `file` cannot be read.
+  static std::unique_ptr<Source> from_file(const std::string &file);
+
+  // The source `text`, e.g. as received over a connection.
+  static std::unique_ptr<Source> from_text(std::string text);
+
+  // The buffer, of `size() + 2` bytes, with the final two bytes null.
+  char *buffer() { return this->mapped ? this->mapped : this->text.data(); }
+
+  // The size of the source, excluding the nulls.
+  size_t size() const { return this->_size; }
+
+private:
+  Source() = default;
+
+  // The text with nulls, if not mapped.
+  std::string text{};
+
+  // The mapped text, and the size of the map, if mapped.
+  char *mapped{nullptr};
+  size_t mapped_size{0};
+
+  size_t _size{0};
+};
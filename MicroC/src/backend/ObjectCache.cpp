@@ -0,0 +1,121 @@
+#include <format>
+#include <sstream>
+
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MD5.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "backend/ObjectCache.hpp"
+
+// Bumped whenever the layout of cached objects, or codegen in general, changes in a way the key does not capture.
+static const char *CACHE_VERSION = "microC-cache-1";
+
+ObjectCache::ObjectCache(std::string directory) : directory(directory) {
+  llvm::sys::fs::create_directories(this->directory);
+}
+
+std::string ObjectCache::default_directory() {
+  llvm::SmallString<128> path;
+  if (!llvm::sys::path::cache_directory(path)) {
+    llvm::sys::fs::current_path(path);
+  }
+  llvm::sys::path::append(path, "microCJIT");
+
+  return std::string(path);
+}
+
+std::string ObjectCache::key(llvm::StringRef source, llvm::StringRef configuration) {
+  llvm::MD5 hash;
+
+  // Lengths are hashed to separate the parts.
+  auto update = [&hash](llvm::StringRef part) {
+    hash.update(std::to_string(part.size()));
+    hash.update(":");
+    hash.update(part);
+  };
+
+  update(CACHE_VERSION);
+  update(LLVM_VERSION_STRING);
+  update(configuration);
+  update(source);
+
+  llvm::MD5::MD5Result result;
+  hash.final(result);
+
+  return std::string(result.digest());
+}
+
+std::unique_ptr<llvm::MemoryBuffer> ObjectCache::lookup(llvm::StringRef key) {
+  auto buffer = llvm::MemoryBuffer::getFile(this->path(key));
+
+  if (!buffer) {
+    this->misses += 1;
+    return nullptr;
+  }
+
+  this->hits += 1;
+  return std::move(*buffer);
+}
+
+void ObjectCache::record() {
+  size_t hits{0};
+  size_t misses{0};
+
+  if (auto buffer = llvm::MemoryBuffer::getFile(this->stats_path())) {
+    std::istringstream in((*buffer)->getBuffer().str());
+    in >> hits >> misses;
+  }
+
+  this->total_hits = hits + this->hits;
+  this->total_misses = misses + this->misses;
+
+  write_atomic(this->stats_path(), std::format("{} {}\n", this->total_hits, this->total_misses));
+}
+
+void ObjectCache::notifyObjectCompiled(const llvm::Module *module, llvm::MemoryBufferRef object) {
+  write_atomic(this->path(module->getModuleIdentifier()), object.getBuffer());
+}
+
+std::unique_ptr<llvm::MemoryBuffer> ObjectCache::getObject(const llvm::Module *module) {
+  auto buffer = llvm::MemoryBuffer::getFile(this->path(module->getModuleIdentifier()));
+  if (!buffer) {
+    return nullptr;
+  }
+
+  return std::move(*buffer);
+}
+
+std::string ObjectCache::path(llvm::StringRef key) const {
+  llvm::SmallString<128> path(this->directory);
+  llvm::sys::path::append(path, key + ".o");
+
+  return std::string(path);
+}
+
+std::string ObjectCache::stats_path() const {
+  llvm::SmallString<128> path(this->directory);
+  llvm::sys::path::append(path, "stats");
+
+  return std::string(path);
+}
+
+void ObjectCache::write_atomic(llvm::StringRef path, llvm::StringRef contents) {
+  int fd;
+  llvm::SmallString<128> tmp_path;
+
+  // Failure to write is not an error, as the cache is only an optimisation.
+  if (llvm::sys::fs::createUniqueFile(path + ".%%%%%%.tmp", fd, tmp_path)) {
+    return;
+  }
+
+  {
+    llvm::raw_fd_ostream out(fd, true);
+    out << contents;
+  }
+
+  if (llvm::sys::fs::rename(tmp_path, path)) {
+    llvm::sys::fs::remove(tmp_path);
+  }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+// A persistent, content addressed, cache of compiled objects.
+//
+// Objects are keyed on the source and a configuration string, which should contain anything else that affects the object.
+// E.g. the optimisation level and the target (triple, cpu, and features).
+//
+// The key of an object is also used as the identifier of the module it is compiled from.
+// This is how the key is passed through LLVM, as `notifyObjectCompiled` / `getObject` only receive the module.
+//
+// Use is either:
+// - `lookup` before parsing, and on a hit add the object to the JIT directly.
+// - Or, on a miss, set the identifier of the module to the key and compile with this as the cache of the compiler.
+struct ObjectCache : llvm::ObjectCache {
+  // The directory holding cached objects.
+  std::string directory;
+
+  // Hits and misses of this process.
+  size_t hits{0};
+  size_t misses{0};
+
+  // Hits and misses over all processes using `directory`, as of the last call to `record`.
+  // Counts are read and written without a lock, so concurrent processes may lose some updates.
+  size_t total_hits{0};
+  size_t total_misses{0};
+
+  ObjectCache(std::string directory);
+
+  // The user cache directory, with a subdirectory for microC.
+  static std::string default_directory();
+
+  // The key for `source` under `configuration`.
+  static std::string key(llvm::StringRef source, llvm::StringRef configuration);
+
+  // The object for `key`, if cached, otherwise nullptr.
+  // Updates hit / miss counts.
+  std::unique_ptr<llvm::MemoryBuffer> lookup(llvm::StringRef key);
+
+  // Adds the counts of this process to the persistent counts of the directory, and updates the total counts.
+  void record();
+
+  // llvm::ObjectCache
+
+  // Writes `object` to the directory, under the identifier of `module`.
+  void notifyObjectCompiled(const llvm::Module *module, llvm::MemoryBufferRef object) override;
+
+  // The object for the identifier of `module`, if cached, otherwise nullptr.
+  std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *module) override;
+
+private:
+  // The path to the object for `key`.
+  std::string path(llvm::StringRef key) const;
+
+  // The path to the persistent counts.
+  std::string stats_path() const;
+
+  // Writes `contents` to `path` by way of a temporary file, so readers never find a partial file.
+  static void write_atomic(llvm::StringRef path, llvm::StringRef contents);
+};
@@ -0,0 +1,54 @@
+#include <format>
+
+#include "llvm/Object/SymbolSize.h"
+#include "llvm/Support/Process.h"
+
+#include "backend/PerfMap.hpp"
+
+PerfMapListener::PerfMapListener()
+    : path(std::format("/tmp/perf-{}.map", llvm::sys::Process::getProcessId())),
+      out(this->path, this->ec) {}
+
+void PerfMapListener::notifyObjectLoaded(ObjectKey key,
+                                         const llvm::object::ObjectFile &object,
+                                         const llvm::RuntimeDyld::LoadedObjectInfo &info) {
+  if (this->ec) {
+    return;
+  }
+
+  // The object for debug has the load address of each section, and so the address of each symbol in this process.
+  auto debug_object = info.getObjectForDebug(object);
+  if (!debug_object.getBinary()) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  for (auto &[symbol, size] : llvm::object::computeSymbolSizes(*debug_object.getBinary())) {
+    auto typ = symbol.getType();
+    if (!typ) {
+      llvm::consumeError(typ.takeError());
+      continue;
+    }
+    if (*typ != llvm::object::SymbolRef::ST_Function || size == 0) {
+      continue;
+    }
+
+    auto name = symbol.getName();
+    if (!name) {
+      llvm::consumeError(name.takeError());
+      continue;
+    }
+
+    auto address = symbol.getAddress();
+    if (!address) {
+      llvm::consumeError(address.takeError());
+      continue;
+    }
+
+    this->out << std::format("{:x} {:x} {}\n", *address, size, name->str());
+  }
+
+  // Flushed on each object, as execution may end with `exit`.
+  this->out.flush();
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+
+#include "llvm/ExecutionEngine/JITEventListener.h"
+#include "llvm/Support/raw_ostream.h"
+
+// Writes a perf map, `/tmp/perf-<pid>.map`, for `--perf`.
+//
+// perf reads the map to name samples in JIT code, with a line for each fn: `<start> <size> <name>`, in hex.
+// The map gives names only, while the jitdump of `PerfJITEventListener` (if LLVM is built with it) also gives code and line tables.
+//
+// Objects may be loaded on any thread of the JIT, and so writes are serialised.
+struct PerfMapListener : llvm::JITEventListener {
+  // The path of the map for this process.
+  std::string path;
+
+  PerfMapListener();
+
+  void notifyObjectLoaded(ObjectKey key,
+                          const llvm::object::ObjectFile &object,
+                          const llvm::RuntimeDyld::LoadedObjectInfo &info) override;
+
+private:
+  std::mutex mutex{};
+  std::error_code ec{};
+  llvm::raw_fd_ostream out;
+};
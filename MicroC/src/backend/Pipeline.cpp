@@ -0,0 +1,183 @@
+#include <algorithm>
+
+#include "llvm/Analysis/CGSCCPassManager.h"
+#include "llvm/Analysis/LoopAnalysisManager.h"
+#include "llvm/IR/Attributes.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Transforms/IPO/FunctionAttrs.h"
+#include "llvm/Transforms/IPO/HotColdSplitting.h"
+#include "llvm/Transforms/Scalar/InductiveRangeCheckElimination.h"
+
+#include "backend/Pipeline.hpp"
+
+llvm::OptimizationLevel Pipeline::optimization_level() const {
+  switch (this->level) {
+  case 0:
+    return llvm::OptimizationLevel::O0;
+  case 1:
+    return llvm::OptimizationLevel::O1;
+  case 2:
+    return llvm::OptimizationLevel::O2;
+  default:
+    return llvm::OptimizationLevel::O3;
+  }
+}
+
+llvm::CodeGenOptLevel Pipeline::codegen_level() const {
+  switch (this->level) {
+  case 0:
+    return llvm::CodeGenOptLevel::None;
+  case 1:
+    return llvm::CodeGenOptLevel::Less;
+  case 2:
+    return llvm::CodeGenOptLevel::Default;
+  default:
+    return llvm::CodeGenOptLevel::Aggressive;
+  }
+}
+
+void Pipeline::run_passes(llvm::Module &module,
+                          std::function<llvm::ModulePassManager(llvm::PassBuilder &)> build) const {
+  // Instrumentation outlives the analysis managers, which hold a pointer to it.
+  llvm::PassInstrumentationCallbacks pic;
+  if (this->pass_timer) {
+    this->pass_timer->registerCallbacks(pic);
+  }
+
+  // Analysis managers for each IR unit.
+  // Declared in this order so destruction happens in reverse, as the proxies require.
+  llvm::LoopAnalysisManager lam;
+  llvm::FunctionAnalysisManager fam;
+  llvm::CGSCCAnalysisManager cgam;
+  llvm::ModuleAnalysisManager mam;
+
+  // As with clang, vectorisation is enabled from O2.
+  llvm::PipelineTuningOptions tuning;
+  tuning.LoopVectorization = 1 < this->level;
+  tuning.SLPVectorization = 1 < this->level;
+
+  llvm::PassBuilder pb(this->target_machine, tuning, std::nullopt, &pic);
+
+  // IndVarSimplify may eliminate a range check where the range of an index is known, and IRCE removes others from loops.
+  if (this->range_checks) {
+    pb.registerScalarOptimizerLateEPCallback(
+        [](llvm::FunctionPassManager &fpm, llvm::OptimizationLevel level) { fpm.addPass(llvm::IRCEPass()); });
+  }
+
+  pb.registerModuleAnalyses(mam);
+  pb.registerCGSCCAnalyses(cgam);
+  pb.registerFunctionAnalyses(fam);
+  pb.registerLoopAnalyses(lam);
+  pb.crossRegisterProxies(lam, fam, cgam, mam);
+
+  llvm::ModulePassManager mpm = build(pb);
+  mpm.run(module, mam);
+}
+
+void Pipeline::run(llvm::Module &module) const {
+  this->run_passes(module, [this](llvm::PassBuilder &pb) {
+    if (this->level == 0) {
+      return pb.buildO0DefaultPipeline(llvm::OptimizationLevel::O0);
+    }
+
+    auto mpm = pb.buildPerModuleDefaultPipeline(this->optimization_level());
+    if (this->profiled) {
+      mpm.addPass(llvm::HotColdSplittingPass());
+    }
+    return mpm;
+  });
+}
+
+void Pipeline::infer_attributes(llvm::Module &module) const {
+  this->run_passes(module, [](llvm::PassBuilder &pb) {
+    llvm::ModulePassManager mpm;
+    mpm.addPass(llvm::createModuleToPostOrderCGSCCPassAdaptor(llvm::PostOrderFunctionAttrsPass()));
+    mpm.addPass(llvm::ReversePostOrderFunctionAttrsPass());
+    return mpm;
+  });
+}
+
+// The attributes of `set`, rebuilt in `context`, as attributes are held by the context they are made in.
+static llvm::AttributeSet rebuild_attributes(llvm::LLVMContext &context, llvm::AttributeSet set) {
+  llvm::AttrBuilder builder(context);
+
+  // Type attributes (`byval`, etc.) are not generated, and so are not rebuilt.
+  for (const llvm::Attribute &attribute : set) {
+    if (attribute.isStringAttribute()) {
+      builder.addAttribute(attribute.getKindAsString(), attribute.getValueAsString());
+    } else if (attribute.isIntAttribute()) {
+      builder.addRawIntAttr(attribute.getKindAsEnum(), attribute.getValueAsInt());
+    } else if (attribute.isConstantRangeAttribute()) {
+      builder.addConstantRangeAttr(attribute.getKindAsEnum(), attribute.getRange());
+    } else if (attribute.isConstantRangeListAttribute()) {
+      builder.addConstantRangeListAttr(attribute.getKindAsEnum(), attribute.getValueAsConstantRangeList());
+    } else if (attribute.isEnumAttribute()) {
+      builder.addAttribute(attribute.getKindAsEnum());
+    }
+  }
+
+  return llvm::AttributeSet::get(context, builder);
+}
+
+// Copy the attributes of the definition `from` to the declaration `to`, of another module.
+// Returns whether the attributes of `to` changed.
+static bool copy_attributes(const llvm::Function &from, llvm::Function &to) {
+  llvm::LLVMContext &context = to.getContext();
+  llvm::AttributeList attributes = from.getAttributes();
+
+  std::vector<llvm::AttributeSet> params{};
+  for (unsigned index = 0; index < from.arg_size(); ++index) {
+    params.push_back(rebuild_attributes(context, attributes.getParamAttrs(index)));
+  }
+
+  // Lists are uniqued by the context, and so equal lists are the same list.
+  auto copied = llvm::AttributeList::get(context,
+                                         rebuild_attributes(context, attributes.getFnAttrs()),
+                                         rebuild_attributes(context, attributes.getRetAttrs()),
+                                         params);
+  if (copied == to.getAttributes()) {
+    return false;
+  }
+
+  to.setAttributes(copied);
+  return true;
+}
+
+void Pipeline::infer_attributes(const std::vector<llvm::Module *> &modules) const {
+  // Modules to infer attributes for, initially each module.
+  std::vector<bool> stale(modules.size(), true);
+
+  // Attributes are only ever added by inference, and so this ends.
+  while (std::find(stale.begin(), stale.end(), true) != stale.end()) {
+    for (size_t index = 0; index < modules.size(); ++index) {
+      if (stale[index]) {
+        this->infer_attributes(*modules[index]);
+      }
+    }
+
+    // Only definitions in a module just inferred may have new attributes.
+    std::vector<bool> changed(modules.size(), false);
+    for (size_t from = 0; from < modules.size(); ++from) {
+      if (!stale[from]) {
+        continue;
+      }
+
+      for (auto &fn : *modules[from]) {
+        // Foundation fns are defined in each module.
+        if (fn.isDeclaration() || fn.hasAvailableExternallyLinkage()) {
+          continue;
+        }
+
+        for (size_t to = 0; to < modules.size(); ++to) {
+          llvm::Function *declaration = to == from ? nullptr : modules[to]->getFunction(fn.getName());
+          if (declaration && declaration->isDeclaration() && copy_attributes(fn, *declaration)) {
+            changed[to] = true;
+          }
+        }
+      }
+    }
+
+    stale = changed;
+  }
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassTimingInfo.h"
+#include "llvm/Passes/OptimizationLevel.h"
+#include "llvm/Passes/PassBuilder.h"
+#include "llvm/Support/CodeGen.h"
+#include "llvm/Target/TargetMachine.h"
+
+// Optimisation of generated IR, using the default pipelines of the (new) pass manager.
+//
+// The pipelines are those used by `clang -O<n>`.
+// So, mem2reg / SROA, instcombine, GVN, LICM, loop unrolling and vectorisation, etc.
+// Of note, codegen makes heavy use of allocas (see the return setup for fns), and mem2reg / SROA do most of the work.
+struct Pipeline {
+  // Optimisation level, from 0 to 3.
+  unsigned level{2};
+
+  // The target, if set, from which the pipeline takes cost models (vector width, etc.).
+  // Without a target passes use generic costs, and notably the loop vectoriser does not vectorise.
+  llvm::TargetMachine *target_machine{nullptr};
+
+  // Whether the module has range checks (from checked codegen).
+  // If so, IRCE is added to the pipeline to remove range checks from loops.
+  bool range_checks{false};
+
+  // Whether the module has a profile attached (see `Profile`).
+  // If so, hot/cold splitting is added to the pipeline to outline blocks the profile shows are cold.
+  bool profiled{false};
+
+  // If set, the time taken by each pass is recorded by the handler.
+  llvm::TimePassesHandler *pass_timer{nullptr};
+
+  Pipeline(unsigned level) : level(level) {}
+
+  // The pass builder optimisation level corresponding to `level`.
+  llvm::OptimizationLevel optimization_level() const;
+
+  // The backend optimisation level corresponding to `level`.
+  llvm::CodeGenOptLevel codegen_level() const;
+
+  // Run the pipeline over `module`, in place.
+  void run(llvm::Module &module) const;
+
+  // Infer fn attributes over the call graph of `module`, in place.
+  // So, `nounwind`, `norecurse`, `willreturn`, and `memory(...)` on fns, and `nocapture`, `readonly`, etc. on pointer args.
+  //
+  // This is separate from `run` as attributes are inferred over the whole module, while the JIT runs the pipeline on a module per fn.
+  // With attributes inferred first, the pipeline of a caller sees the attributes of each callee, and so may CSE or hoist calls to pure fns.
+  void infer_attributes(llvm::Module &module) const;
+
+  // Infer fn attributes over `modules`, each of which defines some fns and declares others (as with partitions).
+  //
+  // The attributes of each definition are copied to the declarations of the fn in other modules, and attributes are inferred again for modules with a changed declaration, until no declaration changes.
+  // So, attributes flow across modules as within a module, with the exception of recursion between modules, which is inferred with no knowledge of the other fns of the cycle.
+  void infer_attributes(const std::vector<llvm::Module *> &modules) const;
+
+private:
+  // Run the module pass manager from `build` over `module`, with analyses and instrumentation for the target.
+  void run_passes(llvm::Module &module, std::function<llvm::ModulePassManager(llvm::PassBuilder &)> build) const;
+};
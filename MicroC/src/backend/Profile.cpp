@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <format>
+#include <limits>
+#include <sstream>
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/ProfileData/ProfileCommon.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+#include "backend/Profile.hpp"
+
+// Whether `fn` is profiled, which is each fn with a definition that is emitted.
+// Foundation fns are defined by the runtime, and their IR definitions are only used for inlining.
+static bool is_profiled(const llvm::Function &fn) {
+  return !fn.isDeclaration() && !fn.hasAvailableExternallyLinkage();
+}
+
+// The conditional branches of `fn`, in order of blocks.
+static std::vector<llvm::BranchInst *> conditional_branches(llvm::Function &fn) {
+  std::vector<llvm::BranchInst *> branches{};
+  for (auto &block : fn) {
+    auto branch = llvm::dyn_cast<llvm::BranchInst>(block.getTerminator());
+    if (branch && branch->isConditional()) {
+      branches.push_back(branch);
+    }
+  }
+  return branches;
+}
+
+// Branch weights are 32 bit, so counts are scaled down to fit if needed.
+static std::pair<uint32_t, uint32_t> branch_weights(uint64_t taken, uint64_t not_taken) {
+  const uint64_t max = std::numeric_limits<uint32_t>::max();
+  uint64_t scale = std::max(taken, not_taken) / max + 1;
+  return {taken / scale, not_taken / scale};
+}
+
+size_t Profile::instrument(llvm::Module &module) {
+  this->layout.clear();
+
+  std::vector<std::pair<llvm::Function *, std::vector<llvm::BranchInst *>>> sites{};
+  size_t count = 0;
+
+  for (auto &fn : module) {
+    if (!is_profiled(fn)) {
+      continue;
+    }
+    auto branches = conditional_branches(fn);
+    count += 1 + 2 * branches.size();
+    this->layout.push_back({fn.getName().str(), branches.size()});
+    sites.push_back({&fn, branches});
+  }
+
+  auto i64_typ = llvm::Type::getInt64Ty(module.getContext());
+  auto counters_typ = llvm::ArrayType::get(i64_typ, count);
+  auto counters = new llvm::GlobalVariable(module,
+                                           counters_typ,
+                                           false,
+                                           llvm::GlobalValue::ExternalLinkage,
+                                           llvm::ConstantAggregateZero::get(counters_typ),
+                                           COUNTERS_NAME);
+
+  auto increment = [&](llvm::IRBuilder<> &builder, size_t index, llvm::Value *by) {
+    auto counter = builder.CreateConstInBoundsGEP2_64(counters_typ, counters, 0, index);
+    auto value = builder.CreateLoad(i64_typ, counter);
+    builder.CreateStore(builder.CreateAdd(value, by), counter);
+  };
+
+  size_t index = 0;
+  for (auto &[fn, branches] : sites) {
+    // Entries are counted after the allocas of the entry block, so the allocas stay together.
+    llvm::BasicBlock &entry = fn->getEntryBlock();
+    auto at = entry.begin();
+    while (llvm::isa<llvm::AllocaInst>(*at)) {
+      ++at;
+    }
+
+    llvm::IRBuilder<> builder(&entry, at);
+    increment(builder, index, builder.getInt64(1));
+    index += 1;
+
+    // The outcome of a branch is counted without splitting edges, as the condition is available at the branch.
+    for (auto branch : branches) {
+      builder.SetInsertPoint(branch);
+      auto taken = builder.CreateZExt(branch->getCondition(), i64_typ, "pgo.taken");
+      increment(builder, index, taken);
+      increment(builder, index + 1, builder.CreateSub(builder.getInt64(1), taken));
+      index += 2;
+    }
+  }
+
+  return count;
+}
+
+void Profile::collect(const uint64_t *counters) {
+  size_t index = 0;
+  for (auto &[name, branch_count] : this->layout) {
+    FnCounts &counts = this->fns[name];
+
+    counts.entries += counters[index];
+    index += 1;
+
+    counts.branches.resize(branch_count);
+    for (auto &[taken, not_taken] : counts.branches) {
+      taken += counters[index];
+      not_taken += counters[index + 1];
+      index += 2;
+    }
+  }
+}
+
+void Profile::write(llvm::raw_ostream &os) const {
+  for (auto &[name, counts] : this->fns) {
+    os << std::format("fn {} {} {}", name, counts.entries, counts.branches.size()) << "\n";
+    for (auto &[taken, not_taken] : counts.branches) {
+      os << std::format("{} {}", taken, not_taken) << "\n";
+    }
+  }
+}
+
+llvm::Expected<Profile> Profile::read(const std::string &path) {
+  auto buffer = llvm::MemoryBuffer::getFile(path);
+  if (!buffer) {
+    return llvm::createStringError(buffer.getError(), std::format("Unable to read profile {}", path));
+  }
+
+  Profile profile{};
+  std::istringstream lines((*buffer)->getBuffer().str());
+
+  for (std::string line; std::getline(lines, line);) {
+    if (line.empty()) {
+      continue;
+    }
+
+    std::istringstream words(line);
+    std::string tag, name;
+    FnCounts counts{};
+    size_t branch_count{0};
+
+    if (!(words >> tag >> name >> counts.entries >> branch_count) || tag != "fn") {
+      return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                     std::format("Invalid profile {}: expected fn at '{}'", path, line));
+    }
+
+    for (size_t i = 0; i < branch_count; ++i) {
+      uint64_t taken, not_taken;
+      std::getline(lines, line);
+      std::istringstream branch_words(line);
+      if (!(branch_words >> taken >> not_taken)) {
+        return llvm::createStringError(llvm::inconvertibleErrorCode(),
+                                       std::format("Invalid profile {}: expected {} branches of {}", path, branch_count, name));
+      }
+      counts.branches.push_back({taken, not_taken});
+    }
+
+    profile.fns[name] = counts;
+  }
+
+  return profile;
+}
+
+size_t Profile::apply(llvm::Module &module) const {
+  llvm::InstrProfSummaryBuilder summary(llvm::ProfileSummaryBuilder::DefaultCutoffs);
+  llvm::MDBuilder md(module.getContext());
+
+  size_t applied = 0;
+
+  for (auto &fn : module) {
+    if (!is_profiled(fn)) {
+      continue;
+    }
+
+    auto it = this->fns.find(fn.getName().str());
+    if (it == this->fns.end()) {
+      continue;
+    }
+    const FnCounts &counts = it->second;
+
+    auto branches = conditional_branches(fn);
+    if (branches.size() != counts.branches.size()) {
+      continue;
+    }
+
+    fn.setEntryCount(counts.entries);
+    summary.addEntryCount(counts.entries);
+
+    // A fn never entered is cold, and so optimised for size and not inlined.
+    if (counts.entries == 0) {
+      fn.addFnAttr(llvm::Attribute::Cold);
+    }
+
+    // A branch never reached keeps any weights from codegen.
+    for (size_t i = 0; i < branches.size(); ++i) {
+      auto [taken, not_taken] = counts.branches[i];
+      summary.addInternalCount(taken + not_taken);
+      if (taken + not_taken == 0) {
+        continue;
+      }
+      auto [taken_weight, not_taken_weight] = branch_weights(taken, not_taken);
+      branches[i]->setMetadata(llvm::LLVMContext::MD_prof, md.createBranchWeights(taken_weight, not_taken_weight));
+    }
+
+    applied += 1;
+  }
+
+  // The summary is used to classify counts as hot or cold, and without a summary the counts are ignored.
+  module.setProfileSummary(summary.getSummary()->getMD(module.getContext()), llvm::ProfileSummary::PSK_Instr);
+
+  return applied;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/raw_ostream.h"
+
+// Profile guided optimisation, for `--pgo-generate` / `--pgo-use`.
+//
+// An instrumented module counts the entries to each fn, and the outcomes of each conditional branch.
+// Counters are held in a single global, `COUNTERS_NAME`, and after execution are read by the JIT and written as a text profile.
+// A profile is then applied to the module of a later compilation (of the same source) as entry counts, branch weights, and a profile summary.
+// With these the inliner, block placement, and hot/cold splitting use the profile in place of static heuristics.
+//
+// Branches are identified by their position in the fn, as generated.
+// So, a profile only applies to the source it was generated from, and a fn with a different count of branches is skipped.
+//
+// The format of a profile is a line for each fn, followed by a line for each branch of the fn:
+//   fn <name> <entries> <branches>
+//   <taken> <not taken>
+struct Profile {
+  static constexpr const char *COUNTERS_NAME = "microc.pgo.counters";
+
+  // The counts of a fn.
+  struct FnCounts {
+    uint64_t entries{0};
+    std::vector<std::pair<uint64_t, uint64_t>> branches{};
+  };
+
+  std::map<std::string, FnCounts> fns{};
+
+  // The fns of an instrumented module, in order of counters, with the count of branches of each.
+  std::vector<std::pair<std::string, size_t>> layout{};
+
+  // Instrument each fn defined in `module`, and record the layout of the counters.
+  // Returns the count of counters.
+  size_t instrument(llvm::Module &module);
+
+  // Read counts from `counters`, the counters of the module instrumented.
+  void collect(const uint64_t *counters);
+
+  void write(llvm::raw_ostream &os) const;
+
+  // Read a profile from `path`, or an error if `path` is not a profile.
+  static llvm::Expected<Profile> read(const std::string &path);
+
+  // Attach the counts of the profile to the fns of `module`.
+  // Returns the count of fns the profile was applied to.
+  size_t apply(llvm::Module &module) const;
+};
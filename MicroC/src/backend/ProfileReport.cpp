@@ -0,0 +1,71 @@
+#include <algorithm>
+#include <format>
+#include <stdexcept>
+
+#include "llvm/Support/JSON.h"
+
+#include "backend/ProfileReport.hpp"
+
+void ProfileReport::collect(const std::vector<ProfileSite> &sites, const uint64_t *counters) {
+  for (size_t index = 0; index < sites.size(); ++index) {
+    this->counts.push_back(Count{sites[index], counters[index]});
+  }
+}
+
+// Ties are in order of source, so sites of a fn are grouped when counts are equal.
+void ProfileReport::sort() {
+  std::stable_sort(this->counts.begin(), this->counts.end(), [](const Count &a, const Count &b) {
+    if (a.count != b.count) {
+      return a.count > b.count;
+    }
+    return a.site.line < b.site.line;
+  });
+}
+
+std::string ProfileReport::kind_string(ProfileSite::Kind kind) {
+  switch (kind) {
+  case ProfileSite::Kind::Fn:
+    return "fn";
+  case ProfileSite::Kind::Loop:
+    return "loop";
+  case ProfileSite::Kind::Then:
+    return "then";
+  case ProfileSite::Kind::Else:
+    return "else";
+  }
+
+  throw std::logic_error("Unknown profile site kind");
+}
+
+void ProfileReport::print(std::ostream &os) const {
+  os << "Profile" << "\n"
+     << "-------" << "\n";
+
+  os << std::format("{:>16} {:<6} {:<24} {}", "Count", "Kind", "Fn", "Location") << "\n";
+  for (auto &[site, count] : this->counts) {
+    os << std::format("{:>16} {:<6} {:<24} {}:{}", count, kind_string(site.kind), site.fn, this->source, site.line) << "\n";
+  }
+
+  os << "-------" << "\n";
+}
+
+void ProfileReport::write_json(llvm::raw_ostream &os) const {
+  llvm::json::OStream json(os, 2);
+
+  json.object([&] {
+    json.attribute("source", this->source);
+
+    json.attributeArray("sites", [&] {
+      for (auto &[site, count] : this->counts) {
+        json.object([&] {
+          json.attribute("kind", kind_string(site.kind));
+          json.attribute("fn", site.fn);
+          json.attribute("line", static_cast<int64_t>(site.line));
+          json.attribute("count", static_cast<int64_t>(count));
+        });
+      }
+    });
+  });
+
+  os << "\n";
+}
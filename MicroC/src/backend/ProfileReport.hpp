@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "llvm/Support/raw_ostream.h"
+
+#include "codegen/Structs.hpp"
+
+// The counts of an execution with profile counters, for `--profile`.
+//
+// Sites are counted by codegen: an entry for each fn, an iteration for each back edge of a while, and an entry for each arm of an if.
+// After execution the counters of each module are read, and the sites are reported in order of count, with the line of the site.
+// Unlike `Profile`, which feeds counts back to the optimiser, this is only a report.
+struct ProfileReport {
+  struct Count {
+    ProfileSite site;
+    uint64_t count;
+  };
+
+  // The source, for locations.
+  std::string source;
+
+  // The count of each site, by descending count once sorted.
+  std::vector<Count> counts{};
+
+  ProfileReport(std::string source) : source(source) {}
+
+  // Read the count of each of `sites` from `counters`, the counters of the module the sites are from.
+  void collect(const std::vector<ProfileSite> &sites, const uint64_t *counters);
+
+  // Sort the counts, once each module has been collected.
+  void sort();
+
+  // Print the report as a table.
+  void print(std::ostream &os) const;
+
+  // Write the report as JSON.
+  void write_json(llvm::raw_ostream &os) const;
+
+  static std::string kind_string(ProfileSite::Kind kind);
+};
@@ -0,0 +1,152 @@
+#include <format>
+
+#include "llvm/IR/Instructions.h"
+#include "llvm/Object/ObjectFile.h"
+#include "llvm/Support/JSON.h"
+
+#include "backend/Report.hpp"
+
+Report::Timer::Timer(Report *report, std::string name)
+    : report(report),
+      name(name),
+      wall_start(std::chrono::steady_clock::now()),
+      cpu_start(std::clock()) {}
+
+Report::Timer::~Timer() {
+  if (!this->report) {
+    return;
+  }
+
+  std::chrono::duration<double, std::milli> wall = std::chrono::steady_clock::now() - this->wall_start;
+  double cpu = 1000.0 * (std::clock() - this->cpu_start) / CLOCKS_PER_SEC;
+
+  this->report->phases.push_back(Phase{this->name, wall.count(), cpu});
+}
+
+void Report::record_module(const llvm::Module &module) {
+  for (auto &fn : module) {
+    if (fn.isDeclaration()) {
+      continue;
+    }
+
+    this->fns.push_back(FnSize{fn.getName().str(), fn.size(), fn.getInstructionCount()});
+  }
+}
+
+void Report::record_bounds_checks(const llvm::Module &module) {
+  const llvm::Function *fail_fn = module.getFunction("microc_bounds_fail");
+  if (!fail_fn) {
+    return;
+  }
+
+  size_t remaining = 0;
+  for (auto user : fail_fn->users()) {
+    if (llvm::isa<llvm::CallInst>(user)) {
+      remaining += 1;
+    }
+  }
+
+  this->bounds_checks_remaining += remaining;
+}
+
+void Report::record_object(llvm::MemoryBufferRef object) {
+  auto object_file = llvm::object::ObjectFile::createObjectFile(object);
+  if (!object_file) {
+    llvm::consumeError(object_file.takeError());
+    return;
+  }
+
+  uint64_t size = 0;
+  for (auto &section : (*object_file)->sections()) {
+    if (section.isText()) {
+      size += section.getSize();
+    }
+  }
+
+  this->code_size += size;
+  this->objects += 1;
+}
+
+void Report::finish() {
+  this->pass_timer.print();
+  this->pass_timings_stream.flush();
+}
+
+void Report::print(std::ostream &os) const {
+  os << "Report" << "\n"
+     << "------" << "\n";
+
+  os << std::format("{:<24} {:>12} {:>12}", "Phase", "Wall (ms)", "CPU (ms)") << "\n";
+  for (auto &phase : this->phases) {
+    os << std::format("{:<24} {:>12.3f} {:>12.3f}", phase.name, phase.wall_ms, phase.cpu_ms) << "\n";
+  }
+  os << "\n";
+
+  os << std::format("{:<24} {:>12}", "AST node", "Count") << "\n";
+  for (auto &[kind, count] : this->ast_nodes) {
+    os << std::format("{:<24} {:>12}", kind, count) << "\n";
+  }
+  os << std::format("AST arena: {} bytes", this->ast_bytes) << "\n";
+  os << "\n";
+
+  os << std::format("{:<24} {:>12} {:>12}", "Fn", "Blocks", "Instructions") << "\n";
+  for (auto &fn : this->fns) {
+    os << std::format("{:<24} {:>12} {:>12}", fn.name, fn.blocks, fn.instructions) << "\n";
+  }
+  os << "\n";
+
+  os << std::format("Code size: {} bytes in {} objects", this->code_size.load(), this->objects.load()) << "\n";
+  os << std::format("Bounds checks: {} generated, {} remaining after optimisation",
+                    this->bounds_checks,
+                    this->bounds_checks_remaining.load())
+     << "\n";
+
+  if (!this->pass_timings.empty()) {
+    os << "\n"
+       << this->pass_timings;
+  }
+
+  os << "------" << "\n";
+}
+
+void Report::write_json(llvm::raw_ostream &os) const {
+  llvm::json::OStream json(os, 2);
+
+  json.object([&] {
+    json.attributeArray("phases", [&] {
+      for (auto &phase : this->phases) {
+        json.object([&] {
+          json.attribute("name", phase.name);
+          json.attribute("wall_ms", phase.wall_ms);
+          json.attribute("cpu_ms", phase.cpu_ms);
+        });
+      }
+    });
+
+    json.attributeObject("ast_nodes", [&] {
+      for (auto &[kind, count] : this->ast_nodes) {
+        json.attribute(kind, static_cast<int64_t>(count));
+      }
+    });
+
+    json.attribute("ast_bytes", static_cast<int64_t>(this->ast_bytes));
+
+    json.attributeArray("fns", [&] {
+      for (auto &fn : this->fns) {
+        json.object([&] {
+          json.attribute("name", fn.name);
+          json.attribute("blocks", static_cast<int64_t>(fn.blocks));
+          json.attribute("instructions", static_cast<int64_t>(fn.instructions));
+        });
+      }
+    });
+
+    json.attribute("code_size", static_cast<int64_t>(this->code_size.load()));
+    json.attribute("objects", static_cast<int64_t>(this->objects.load()));
+    json.attribute("bounds_checks", static_cast<int64_t>(this->bounds_checks));
+    json.attribute("bounds_checks_remaining", static_cast<int64_t>(this->bounds_checks_remaining.load()));
+    json.attribute("pass_timings", this->pass_timings);
+  });
+
+  os << "\n";
+}
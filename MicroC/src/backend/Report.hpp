@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "llvm/IR/Module.h"
+#include "llvm/IR/PassTimingInfo.h"
+#include "llvm/Support/MemoryBufferRef.h"
+#include "llvm/Support/raw_ostream.h"
+
+// Statistics on a run of the compiler, for `-time` / `--report`.
+//
+// Phases are timed by the driver, while the remaining statistics are recorded as the relevant phase happens.
+// Note, as fns are compiled lazily, the time taken to execute includes the time taken to compile most fns.
+struct Report {
+  // The wall and CPU time of a phase, in milliseconds.
+  struct Phase {
+    std::string name;
+    double wall_ms;
+    double cpu_ms;
+  };
+
+  // The size of a fn, as generated.
+  struct FnSize {
+    std::string name;
+    size_t blocks;
+    size_t instructions;
+  };
+
+  // Times a phase from construction to destruction.
+  // With no report, nothing is timed.
+  struct Timer {
+    Report *report;
+    std::string name;
+    std::chrono::steady_clock::time_point wall_start;
+    std::clock_t cpu_start;
+
+    Timer(Report *report, std::string name);
+    ~Timer();
+
+    Timer(const Timer &) = delete;
+    Timer &operator=(const Timer &) = delete;
+  };
+
+  std::vector<Phase> phases{};
+
+  // Counts of AST nodes, by kind.
+  std::map<std::string, size_t> ast_nodes{};
+
+  // Bytes allocated in the arena of the AST.
+  size_t ast_bytes{0};
+
+  std::vector<FnSize> fns{};
+
+  // Bytes of executable code in the objects handed to the JIT linker, and the count of objects.
+  // Atomic, as objects may be linked away from the main thread.
+  std::atomic<uint64_t> code_size{0};
+  std::atomic<size_t> objects{0};
+
+  // Bounds checks from checked codegen, as generated and as remaining after optimisation.
+  size_t bounds_checks{0};
+  std::atomic<size_t> bounds_checks_remaining{0};
+
+  // Pass timings are written here by `pass_timer`, and so this is declared first to outlive the handler.
+  std::string pass_timings{};
+  llvm::raw_string_ostream pass_timings_stream{pass_timings};
+
+  // Handler for LLVM pass timings, shared by each run of the pipeline.
+  llvm::TimePassesHandler pass_timer{true};
+
+  Report() { this->pass_timer.setOutStream(this->pass_timings_stream); }
+
+  // Record the size of each fn defined in `module`.
+  void record_module(const llvm::Module &module);
+
+  // Record the bounds checks remaining in `module`, after optimisation.
+  void record_bounds_checks(const llvm::Module &module);
+
+  // Record the size of the executable sections of `object`.
+  void record_object(llvm::MemoryBufferRef object);
+
+  // Collect the timings of LLVM passes, which resets the timers.
+  void finish();
+
+  // Print the report as a table.
+  void print(std::ostream &os) const;
+
+  // Write the report as JSON.
+  void write_json(llvm::raw_ostream &os) const;
+};
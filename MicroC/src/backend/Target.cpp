@@ -0,0 +1,28 @@
+#include "llvm/ADT/StringRef.h"
+#include "llvm/TargetParser/SubtargetFeature.h"
+
+#include "backend/Target.hpp"
+
+llvm::Expected<llvm::orc::JITTargetMachineBuilder> detect_target(std::optional<std::string> cpu,
+                                                                 std::optional<std::string> features) {
+  auto jtmb = llvm::orc::JITTargetMachineBuilder::detectHost();
+  if (!jtmb) {
+    return jtmb.takeError();
+  }
+
+  if (cpu.has_value()) {
+    jtmb->setCPU(cpu.value());
+    jtmb->getFeatures() = llvm::SubtargetFeatures();
+  }
+
+  if (features.has_value()) {
+    llvm::SmallVector<llvm::StringRef> split_features;
+    llvm::StringRef(features.value()).split(split_features, ',', -1, false);
+
+    for (auto feature : split_features) {
+      jtmb->getFeatures().AddFeature(feature.trim());
+    }
+  }
+
+  return std::move(*jtmb);
+}
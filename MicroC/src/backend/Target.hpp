@@ -0,0 +1,15 @@
+#pragma once
+
+#include <optional>
+#include <string>
+
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/Support/Error.h"
+
+// Detects the host, for codegen tuned to the host CPU.
+//
+// The host CPU and each feature it supports (AVX2, AVX-512, etc.) are enabled by default.
+// If `cpu` is given the host features are dropped, as they need not be supported by `cpu`.
+// Then, `features` is a comma separated list of features to add to or remove from those, e.g. `+avx2,-avx512f`.
+llvm::Expected<llvm::orc::JITTargetMachineBuilder> detect_target(std::optional<std::string> cpu,
+                                                                 std::optional<std::string> features);
@@ -0,0 +1,189 @@
+#include <set>
+
+#include "llvm/ExecutionEngine/Orc/CompileUtils.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/MDBuilder.h"
+#include "llvm/Transforms/Utils/BasicBlockUtils.h"
+
+#include "backend/Tiering.hpp"
+
+// Whether `fn` is tiered.
+static bool is_tiered(const llvm::Function &fn) {
+  return !fn.isDeclaration() && !fn.hasAvailableExternallyLinkage() && !fn.getName().starts_with("microc.");
+}
+
+void Tiering::rewrite(llvm::Module &module) {
+  auto ptr_typ = llvm::PointerType::getUnqual(module.getContext());
+  auto ptr_align = module.getDataLayout().getPointerABIAlignment(0);
+
+  this->fns.clear();
+
+  for (auto &fn : module) {
+    if (!is_tiered(fn)) {
+      continue;
+    }
+    this->fns.push_back(fn.getName().str());
+
+    // Calls are collected first, as the initialiser of the slot is also a use of the fn.
+    std::vector<llvm::CallInst *> calls{};
+    for (auto user : fn.users()) {
+      auto call = llvm::dyn_cast<llvm::CallInst>(user);
+      if (call && call->getCalledOperand() == &fn) {
+        calls.push_back(call);
+      }
+    }
+
+    auto slot = new llvm::GlobalVariable(module,
+                                         ptr_typ,
+                                         false,
+                                         llvm::GlobalValue::ExternalLinkage,
+                                         &fn,
+                                         slot_name(fn.getName().str()));
+    slot->setAlignment(ptr_align);
+
+    // The type of the call is unchanged, and so attributes and tail call markers are kept.
+    for (auto call : calls) {
+      llvm::IRBuilder<> builder(call);
+      auto target = builder.CreateAlignedLoad(ptr_typ, slot, ptr_align, "tier.target");
+      target->setAtomic(llvm::AtomicOrdering::Acquire);
+      call->setCalledOperand(target);
+    }
+  }
+}
+
+void Tiering::instrument(llvm::Module &module) const {
+  llvm::LLVMContext &context = module.getContext();
+  auto i64_typ = llvm::Type::getInt64Ty(context);
+
+  auto counts_typ = llvm::ArrayType::get(i64_typ, this->fns.size());
+  auto counts = new llvm::GlobalVariable(module,
+                                         counts_typ,
+                                         false,
+                                         llvm::GlobalValue::ExternalLinkage,
+                                         llvm::ConstantAggregateZero::get(counts_typ),
+                                         COUNTS_NAME);
+
+  auto tier_up_typ = llvm::FunctionType::get(llvm::Type::getVoidTy(context), {i64_typ}, false);
+  auto tier_up = module.getOrInsertFunction(TIER_UP_NAME, tier_up_typ);
+  llvm::cast<llvm::Function>(tier_up.getCallee())->addFnAttr(llvm::Attribute::NoUnwind);
+
+  auto unlikely = llvm::MDBuilder(context).createBranchWeights(1, 2000);
+
+  for (size_t id = 0; id < this->fns.size(); ++id) {
+    llvm::Function *fn = module.getFunction(this->fns[id]);
+
+    // Attributes are inferred ahead of instrumentation, and so for tier 1.
+    // Counts are writes, and tier up takes a lock and may allocate, so attributes which these contradict are dropped.
+    fn->removeFnAttr(llvm::Attribute::Memory);
+    fn->removeFnAttr(llvm::Attribute::NoSync);
+    fn->removeFnAttr(llvm::Attribute::NoFree);
+    fn->removeFnAttr(llvm::Attribute::WillReturn);
+
+    // Counted at the entry, after the allocas, and at the header of each loop.
+    // Headers are found as the targets of back edges, which are the edges to a block that dominates the source.
+    std::vector<llvm::Instruction *> sites{};
+
+    auto at = fn->getEntryBlock().begin();
+    while (llvm::isa<llvm::AllocaInst>(*at)) {
+      ++at;
+    }
+    sites.push_back(&*at);
+
+    llvm::DominatorTree dt(*fn);
+    std::set<llvm::BasicBlock *> headers{};
+    for (auto &block : *fn) {
+      if (!dt.isReachableFromEntry(&block)) {
+        continue;
+      }
+      for (auto successor : llvm::successors(&block)) {
+        if (dt.dominates(successor, &block)) {
+          headers.insert(successor);
+        }
+      }
+    }
+    for (auto header : headers) {
+      sites.push_back(&*header->getFirstInsertionPt());
+    }
+
+    for (auto site : sites) {
+      llvm::IRBuilder<> builder(site);
+      auto count = builder.CreateConstInBoundsGEP2_64(counts_typ, counts, 0, id);
+      auto next = builder.CreateAdd(builder.CreateLoad(i64_typ, count), builder.getInt64(1), "tier.count");
+      builder.CreateStore(next, count);
+
+      // Equality, so tier up is requested once.
+      auto hot = builder.CreateICmpEQ(next, builder.getInt64(this->threshold), "tier.hot");
+      auto request = llvm::SplitBlockAndInsertIfThen(hot, site, false, unlikely);
+      llvm::IRBuilder<>(request).CreateCall(tier_up, {llvm::ConstantInt::get(i64_typ, id)});
+    }
+  }
+}
+
+void Tiering::mark_optimised(llvm::Module &module, const std::string &fn) {
+  module.getFunction(fn)->setName(optimised_name(fn));
+  module.addModuleFlag(llvm::Module::Warning, FLAG_NAME, 1);
+}
+
+void Tiering::start(std::function<void(size_t)> compile) {
+  this->worker = std::thread([this, compile]() {
+    while (true) {
+      size_t id;
+      {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->queued.wait(lock, [this]() { return this->stopping || !this->queue.empty(); });
+        if (this->stopping) {
+          return;
+        }
+        id = this->queue.front();
+        this->queue.pop_front();
+      }
+      compile(id);
+    }
+  });
+}
+
+void Tiering::request(size_t id) {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->queue.push_back(id);
+  }
+  this->queued.notify_one();
+}
+
+void Tiering::stop() {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stopping = true;
+  }
+  this->queued.notify_one();
+
+  if (this->worker.joinable()) {
+    this->worker.join();
+  }
+}
+
+TieredCompiler::TieredCompiler(llvm::orc::JITTargetMachineBuilder jtmb)
+    : IRCompiler(llvm::orc::irManglingOptionsFromTargetOptions(jtmb.getOptions())), jtmb(jtmb) {}
+
+llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>> TieredCompiler::operator()(llvm::Module &module) {
+  // A target machine for each module, as modules of each tier are compiled concurrently.
+  llvm::orc::JITTargetMachineBuilder tier_jtmb = this->jtmb;
+  bool optimised = Tiering::is_optimised(module);
+  if (!optimised) {
+    tier_jtmb.setCodeGenOptLevel(llvm::CodeGenOptLevel::None);
+  }
+
+  auto tm = tier_jtmb.createTargetMachine();
+  if (!tm) {
+    return tm.takeError();
+  }
+  if (!optimised) {
+    (*tm)->setFastISel(true);
+  }
+
+  return llvm::orc::SimpleCompiler(**tm)(module);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "llvm/ExecutionEngine/Orc/IRCompileLayer.h"
+#include "llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h"
+#include "llvm/IR/Module.h"
+
+// Tiered execution, for `--tiered`.
+//
+// Each fn starts at tier 0, compiled without optimisation and with FastISel, so compilation is cheap.
+// Calls between fns are made through a slot per fn, `<fn>.tier`, which holds the address of the current tier of the fn.
+// Tier 0 counts entries and loop iterations of each fn, and a fn whose count reaches `threshold` is queued for tier up.
+// A background thread then compiles the fn at the optimisation level of the pipeline, as `<fn>.tier1`, and swaps the slot.
+//
+// There is no on stack replacement, so a call running at tier 0 finishes at tier 0.
+// And, as calls are through slots, tier 1 code calls the current tier of each fn.
+//
+// Fns with a `microc.` prefix (e.g. the entry fn) and foundation fns are not tiered.
+struct Tiering {
+  static constexpr const char *COUNTS_NAME = "microc.tier.counts";
+  static constexpr const char *TIER_UP_NAME = "microc_tier_up";
+  static constexpr const char *FLAG_NAME = "microc.tier";
+
+  // The count of entries and loop iterations at which a fn is queued for tier up.
+  uint64_t threshold{10000};
+
+  // The tiered fns, indexed by id.
+  std::vector<std::string> fns{};
+
+  // The name of the slot of `fn`.
+  static std::string slot_name(const std::string &fn) { return fn + ".tier"; }
+
+  // The name of the tier 1 definition of `fn`.
+  static std::string optimised_name(const std::string &fn) { return fn + ".tier1"; }
+
+  // Whether `module` holds a tier 1 definition.
+  static bool is_optimised(const llvm::Module &module) { return module.getModuleFlag(FLAG_NAME) != nullptr; }
+
+  // Give each tiered fn a slot, and rewrite each call to a tiered fn as a call through the slot.
+  // Shared by both tiers, and so to be applied before either is derived from `module`.
+  void rewrite(llvm::Module &module);
+
+  // Count entries and loop iterations of each tiered fn in `module`, and request tier up at the threshold.
+  // Tier 0 only, and so after attribute inference, with attributes of each tiered fn which the counts contradict (e.g. `memory(none)`) dropped.
+  void instrument(llvm::Module &module) const;
+
+  // Mark `module` as holding the tier 1 definition of `fn`, renamed to `optimised_name(fn)`.
+  static void mark_optimised(llvm::Module &module, const std::string &fn);
+
+  // Start the background thread, which calls `compile` with the id of each fn queued.
+  void start(std::function<void(size_t)> compile);
+
+  // Queue fn `id` for tier up. Safe to call from any thread.
+  void request(size_t id);
+
+  // Stop the background thread, after any tier up in progress, and drop any others queued.
+  void stop();
+
+private:
+  std::mutex mutex{};
+  std::condition_variable queued{};
+  std::deque<size_t> queue{};
+  bool stopping{false};
+  std::thread worker{};
+};
+
+// Compiles modules with tier 1 definitions at the codegen level of `jtmb`, and others with FastISel and no optimisation.
+struct TieredCompiler : llvm::orc::IRCompileLayer::IRCompiler {
+  llvm::orc::JITTargetMachineBuilder jtmb;
+
+  TieredCompiler(llvm::orc::JITTargetMachineBuilder jtmb);
+
+  llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>> operator()(llvm::Module &module) override;
+};
@@ -4,6 +4,7 @@
 #include "llvm/IR/Constants.h"
 #include "llvm/IR/DIBuilder.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/IntrinsicInst.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 
@@ -19,6 +20,13 @@
 // Return the fn as the implementation doesn't permit prototypes independent of a body declaration.
 // If revised to do so, the fn generation should be abstracted as this is called during fn declaration.
 llvm::Value *AST::Dec::Prototype::codegen(Context &ctx) const {
+  // The fn may be declared ahead of the body, as with partitioned codegen.
+  llvm::Function *declared = ctx.module->getFunction(this->id);
+  if (declared && declared->isDeclaration()) {
+    ctx.env_llvm.fns.bind(this->sym, declared);
+    return declared;
+  }
+
   llvm::Type *return_type = this->return_type()->codegen(ctx);
 
   std::vector<llvm::Type *> arg_types{};
@@ -33,11 +41,49 @@ llvm::Value *AST::Dec::Prototype::codegen(Context &ctx) const {
                                               this->id,
                                               ctx.module.get());
 
-  ctx.env_llvm.fns[this->id] = fn;
+  // microC has no exceptions, and further attributes are inferred after codegen (see `Pipeline::infer_attributes`).
+  fn->addFnAttr(llvm::Attribute::NoUnwind);
+
+  ctx.env_llvm.fns.bind(this->sym, fn);
 
   return fn;
 }
 
+// Whether the address of `ptr`, an alloca or derived from an alloca, escapes.
+// Loads from and stores to the address do not, nor do lifetime markers, while anything else is assumed to.
+static bool address_escapes(llvm::Value *ptr) {
+  for (auto user : ptr->users()) {
+    if (llvm::isa<llvm::LoadInst>(user)) {
+      continue;
+    }
+
+    if (auto store = llvm::dyn_cast<llvm::StoreInst>(user)) {
+      if (store->getValueOperand() == ptr) {
+        return true;
+      }
+      continue;
+    }
+
+    if (auto intrinsic = llvm::dyn_cast<llvm::IntrinsicInst>(user)) {
+      if (intrinsic->isLifetimeStartOrEnd()) {
+        continue;
+      }
+      return true;
+    }
+
+    if (llvm::isa<llvm::GetElementPtrInst>(user)) {
+      if (address_escapes(user)) {
+        return true;
+      }
+      continue;
+    }
+
+    return true;
+  }
+
+  return false;
+}
+
 // Fn
 // The fn codegen is sourced to prototype codegen, though see comments for issues with this.
 // The codegen given is for the body.
@@ -56,11 +102,12 @@ llvm::Value *AST::Dec::Fn::codegen(Context &ctx) const {
   llvm::BasicBlock *outer_return_block = ctx.env_llvm.return_block; // to be restored on exit
   llvm::Value *outer_return_alloca = ctx.env_llvm.return_alloca;    // likewise for return value allocation
 
-  std::vector<std::pair<std::string, llvm::Value *>> shadowed_args{};
-  std::vector<std::string> fresh_args{};
-
   llvm::BasicBlock *fn_body = llvm::BasicBlock::Create(*ctx.context, "entry", fn);
   ctx.builder.SetInsertPoint(fn_body);
+  ctx.begin_fn_debug_info(fn, this->prototype->line);
+
+  // Parameters are scoped to the fn, and shadow any globals of the same name.
+  ctx.env_llvm.vars.enter();
 
   { // Parameters
     size_t arg_idx{0};
@@ -69,13 +116,6 @@ llvm::Value *AST::Dec::Fn::codegen(Context &ctx) const {
       auto &arg_var = this->prototype->args[arg_idx].var;
       auto &arg_typ = this->prototype->args[arg_idx].typ;
 
-      auto it = ctx.env_llvm.vars.find(arg_var);
-      if (it != ctx.env_llvm.vars.end()) {
-        shadowed_args.push_back(std::make_pair(arg_var, it->second));
-      } else {
-        fresh_args.push_back(arg_var);
-      }
-
       arg.setName(arg_var);
 
       llvm::AllocaInst *alloca = ctx.builder.CreateAlloca(arg.getType(),
@@ -83,7 +123,7 @@ llvm::Value *AST::Dec::Fn::codegen(Context &ctx) const {
                                                           std::format("arg.{}", arg_var));
       ctx.builder.CreateStore(&arg, alloca);
 
-      ctx.env_llvm.vars[arg_var] = alloca;
+      ctx.env_llvm.vars.bind(this->prototype->args[arg_idx].sym, alloca);
 
       arg_idx += 1;
     }
@@ -101,6 +141,7 @@ llvm::Value *AST::Dec::Fn::codegen(Context &ctx) const {
   }
 
   ctx.builder.SetInsertPoint(fn_body);
+  ctx.count_site(ProfileSite::Kind::Fn, this->prototype->line);
 
   // codegen the body
   this->body->codegen(ctx);
@@ -118,26 +159,38 @@ llvm::Value *AST::Dec::Fn::codegen(Context &ctx) const {
     ctx.builder.CreateRetVoid();
   }
 
-  // maintain the env
-  ctx.env_llvm.return_block = outer_return_block;
-  ctx.env_llvm.return_alloca = outer_return_alloca;
-
-  //
-  for (auto &shadowed : shadowed_args) {
-    ctx.env_llvm.vars[shadowed.first] = shadowed.second;
+  // Tail calls may not access the frame of the caller, which is released before the call.
+  // So, if the address of any alloca escapes, tail call markers are removed.
+  bool escapes = false;
+  for (auto &inst : fn->getEntryBlock()) {
+    if (auto alloca = llvm::dyn_cast<llvm::AllocaInst>(&inst)) {
+      escapes = escapes || address_escapes(alloca);
+    }
   }
 
-  for (auto &fresh : fresh_args) {
-    ctx.env_llvm.vars.erase(fresh);
+  if (escapes) {
+    for (auto &block : *fn) {
+      for (auto &inst : block) {
+        if (auto call = llvm::dyn_cast<llvm::CallInst>(&inst)) {
+          call->setTailCallKind(llvm::CallInst::TCK_None);
+        }
+      }
+    }
   }
 
+  // maintain the env
+  ctx.end_fn_debug_info();
+  ctx.env_llvm.return_block = outer_return_block;
+  ctx.env_llvm.return_alloca = outer_return_alloca;
+  ctx.env_llvm.vars.exit();
+
   // TODO: Finish...
   return llvm::ConstantInt::get(llvm::Type::getInt64Ty(*ctx.context), 2020);
 }
 
+// Local variables are allocated in the entry block of the fn, with the scope of the variable marked by lifetime markers.
+// The start of the scope is marked here, and the end is marked by block codegen.
 llvm::Value *AST::Dec::Var::codegen(Context &ctx) const {
-  auto existing = ctx.env_llvm.vars.find(this->var());
-
   auto typ = this->_typ->codegen(ctx);
   auto var = this->var();
 
@@ -149,7 +202,7 @@ llvm::Value *AST::Dec::Var::codegen(Context &ctx) const {
 
   case Typ::Kind::Ptr: {
 
-    auto as_ptr = std::static_pointer_cast<Typ::Ptr>(this->_typ);
+    auto as_ptr = static_cast<Typ::Ptr *>(this->_typ);
     auto ptr = llvm::PointerType::getUnqual(*ctx.context);
     auto default_val = llvm::ConstantPointerNull::get(ptr);
 
@@ -157,15 +210,15 @@ llvm::Value *AST::Dec::Var::codegen(Context &ctx) const {
     // That is, on a whether the pointer is (explicitly) to an array or not.
     if (as_ptr->area().has_value()) {
 
-      llvm::ArrayType *array_typ = llvm::ArrayType::get(as_ptr->pointee_typ()->codegen(ctx),
-                                                        as_ptr->area().value());
+      auto array_typ = llvm::cast<llvm::ArrayType>(typ);
 
       switch (this->scope) {
 
       case Scope::Local: {
 
-        auto alloca = ctx.builder.CreateAlloca(typ, nullptr, var); // Create
-        ctx.env_llvm.vars[var] = alloca;                           // Update env
+        auto alloca = ctx.create_entry_alloca(typ, var);                  // Create
+        ctx.builder.CreateLifetimeStart(alloca, ctx.alloca_size(alloca)); // Scope start
+        ctx.env_llvm.vars.bind(this->sym, alloca);                        // Update env
 
       } break;
 
@@ -173,9 +226,11 @@ llvm::Value *AST::Dec::Var::codegen(Context &ctx) const {
 
         ctx.module->getOrInsertGlobal(var, array_typ);                                   // Create
         llvm::GlobalVariable *globalVar = ctx.module->getNamedGlobal(var);               // Find
-        llvm::ConstantAggregateZero *init = llvm::ConstantAggregateZero::get(array_typ); // Init a.
-        globalVar->setInitializer(init);                                                 // Init b.
-        ctx.env_llvm.vars[var] = globalVar;                                              // Update env
+        if (ctx.define_globals) {
+          llvm::ConstantAggregateZero *init = llvm::ConstantAggregateZero::get(array_typ); // Init a.
+          globalVar->setInitializer(init);                                                 // Init b.
+        }
+        ctx.env_llvm.vars.bind(this->sym, globalVar);                                    // Update env
 
       } break;
       }
@@ -189,8 +244,9 @@ llvm::Value *AST::Dec::Var::codegen(Context &ctx) const {
 
       case Scope::Local: {
 
-        auto alloca = ctx.builder.CreateAlloca(typ, nullptr, var);
-        ctx.env_llvm.vars[var] = alloca;
+        auto alloca = ctx.create_entry_alloca(typ, var);
+        ctx.builder.CreateLifetimeStart(alloca, ctx.alloca_size(alloca));
+        ctx.env_llvm.vars.bind(this->sym, alloca);
 
       } break;
 
@@ -198,8 +254,10 @@ llvm::Value *AST::Dec::Var::codegen(Context &ctx) const {
 
         ctx.module->getOrInsertGlobal(var, typ);
         llvm::GlobalVariable *globalVar = ctx.module->getNamedGlobal(var);
-        globalVar->setInitializer(default_val);
-        ctx.env_llvm.vars[var] = globalVar;
+        if (ctx.define_globals) {
+          globalVar->setInitializer(default_val);
+        }
+        ctx.env_llvm.vars.bind(this->sym, globalVar);
 
       } break;
       }
@@ -211,15 +269,16 @@ llvm::Value *AST::Dec::Var::codegen(Context &ctx) const {
 
   case Typ::Kind::Int: {
 
-    auto as_int = std::static_pointer_cast<AST::Typ::Int>(this->_typ);
+    auto as_int = static_cast<AST::Typ::Int *>(this->_typ);
     auto default_val = as_int->defaultgen(ctx);
 
     switch (this->scope) {
 
     case Scope::Local: {
 
-      auto alloca = ctx.builder.CreateAlloca(typ, nullptr, var);
-      ctx.env_llvm.vars[var] = alloca;
+      auto alloca = ctx.create_entry_alloca(typ, var);
+      ctx.builder.CreateLifetimeStart(alloca, ctx.alloca_size(alloca));
+      ctx.env_llvm.vars.bind(this->sym, alloca);
 
     } break;
 
@@ -227,8 +286,10 @@ llvm::Value *AST::Dec::Var::codegen(Context &ctx) const {
 
       ctx.module->getOrInsertGlobal(var, typ);
       llvm::GlobalVariable *globalVar = ctx.module->getNamedGlobal(var);
-      globalVar->setInitializer(default_val);
-      ctx.env_llvm.vars[var] = globalVar;
+      if (ctx.define_globals) {
+        globalVar->setInitializer(default_val);
+      }
+      ctx.env_llvm.vars.bind(this->sym, globalVar);
 
     } break;
     }
@@ -239,15 +300,16 @@ llvm::Value *AST::Dec::Var::codegen(Context &ctx) const {
 
   case Typ::Kind::Char: {
 
-    auto as_char = std::static_pointer_cast<AST::Typ::Char>(this->_typ);
+    auto as_char = static_cast<AST::Typ::Char *>(this->_typ);
     auto default_val = as_char->defaultgen(ctx);
 
     switch (this->scope) {
 
     case Scope::Local: {
 
-      auto alloca = ctx.builder.CreateAlloca(typ, nullptr, var);
-      ctx.env_llvm.vars[var] = alloca;
+      auto alloca = ctx.create_entry_alloca(typ, var);
+      ctx.builder.CreateLifetimeStart(alloca, ctx.alloca_size(alloca));
+      ctx.env_llvm.vars.bind(this->sym, alloca);
 
     } break;
 
@@ -255,8 +317,10 @@ llvm::Value *AST::Dec::Var::codegen(Context &ctx) const {
 
       ctx.module->getOrInsertGlobal(var, typ);
       llvm::GlobalVariable *globalVar = ctx.module->getNamedGlobal(var);
-      globalVar->setInitializer(default_val);
-      ctx.env_llvm.vars[var] = globalVar;
+      if (ctx.define_globals) {
+        globalVar->setInitializer(default_val);
+      }
+      ctx.env_llvm.vars.bind(this->sym, globalVar);
 
     } break;
     }
@@ -7,6 +7,7 @@
 #include "llvm/IR/DIBuilder.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Module.h"
 
 #include "AST/AST.hpp"
@@ -14,13 +15,11 @@
 #include "codegen/Structs.hpp"
 
 llvm::Value *AST::Expr::Var::codegen(Context &ctx, AST::Expr::Value value) const {
-  auto find_var = ctx.env_llvm.vars.find(this->var);
-  if (find_var == ctx.env_llvm.vars.end()) {
+  auto val = ctx.env_llvm.vars.find(this->sym);
+  if (!val) {
     throw std::logic_error(std::format("Missing variable: {}", this->var));
   }
 
-  auto val = find_var->second;
-
   if (value == AST::Expr::Value::R) {
     switch (this->typ()->kind()) {
 
@@ -31,7 +30,7 @@ llvm::Value *AST::Expr::Var::codegen(Context &ctx, AST::Expr::Value value) const
     } break;
 
     case Typ::Kind::Ptr: {
-      auto ptr_typ = std::static_pointer_cast<AST::Typ::Ptr>(this->typ());
+      auto ptr_typ = static_cast<AST::Typ::Ptr *>(this->typ());
       if (ptr_typ->area().has_value()) {
         val = ctx.builder.CreateInBoundsGEP(ptr_typ->codegen(ctx),
                                             val,
@@ -55,10 +54,10 @@ llvm::Value *AST::Expr::Var::codegen(Context &ctx, AST::Expr::Value value) const
 llvm::Value *AST::Expr::Call::codegen(Context &ctx, AST::Expr::Value value) const {
 
   llvm::Function *callee_f = ctx.module->getFunction(this->name);
-  auto prototype = ctx.env_ast.fns.find(this->name)->second.get();
+  auto prototype = ctx.env_ast.fns.find(this->sym);
 
   if (callee_f == nullptr) {
-    auto it = ctx.foundation_fn_map.find(this->name);
+    auto it = ctx.foundation_fn_map.find(std::string(this->name));
     if (it != ctx.foundation_fn_map.end()) {
       callee_f = it->second->codegen(ctx);
     } else {
@@ -146,7 +145,7 @@ llvm::Value *AST::Expr::Prim1::codegen(Context &ctx, AST::Expr::Value value) con
   } break;
 
   case OpUnary::Dereference: {
-    auto ptr_typ = std::static_pointer_cast<AST::Typ::Ptr>(expr->typ());
+    auto ptr_typ = static_cast<AST::Typ::Ptr *>(expr->typ());
 
     val = this->expr->codegen(ctx, AST::Expr::Value::R);
 
@@ -161,7 +160,7 @@ llvm::Value *AST::Expr::Prim1::codegen(Context &ctx, AST::Expr::Value value) con
       } break;
 
       case Typ::Kind::Ptr: {
-        auto ptr_typ = std::static_pointer_cast<AST::Typ::Ptr>(this->typ());
+        auto ptr_typ = static_cast<AST::Typ::Ptr *>(this->typ());
         if (ptr_typ->area().has_value()) {
           val = ctx.builder.CreateInBoundsGEP(ptr_typ->codegen(ctx),
                                               val,
@@ -250,6 +249,66 @@ llvm::Value *builder_assign(Context &ctx, AST::ExprHandle destination, AST::Expr
   return value_val;
 }
 
+// Codegen for compound assignment, e.g. `+=`.
+// The address of the destination is computed once, and used for both the load and the store.
+// So, for example, `a[i] += x` computes the element pointer of `a[i]` once.
+llvm::Value *builder_assign_compound(Context &ctx, const AST::Expr::Prim2 *expr) {
+
+  llvm::Value *desti_ptr = expr->lhs->codegen(ctx, AST::Expr::Value::L);
+  llvm::Value *value_val = expr->rhs->codegen(ctx, AST::Expr::Value::R);
+
+  llvm::Value *desti_val = ctx.builder.CreateLoad(expr->lhs->typ()->codegen(ctx), desti_ptr, "op.assign.load");
+
+  bool is_ptr = expr->lhs->typ_has_kind(AST::Typ::Kind::Ptr);
+
+  llvm::Value *val;
+
+  switch (expr->op) {
+
+  case AST::Expr::OpBinary::AssignAdd: {
+    if (is_ptr) {
+      val = ctx.builder.CreateInBoundsGEP(expr->lhs->typ()->deref()->codegen(ctx),
+                                          desti_val,
+                                          llvm::ArrayRef<llvm::Value *>{value_val},
+                                          "add.ptr");
+    } else {
+      val = ctx.builder.CreateAdd(desti_val, value_val, "op.add");
+    }
+  } break;
+
+  case AST::Expr::OpBinary::AssignSub: {
+    if (is_ptr) {
+      val = ctx.builder.CreateInBoundsGEP(expr->lhs->typ()->deref()->codegen(ctx),
+                                          desti_val,
+                                          llvm::ArrayRef<llvm::Value *>{ctx.builder.CreateNeg(value_val)},
+                                          "sub.ptr");
+    } else {
+      val = ctx.builder.CreateSub(desti_val, value_val, "op.sub");
+    }
+  } break;
+
+  case AST::Expr::OpBinary::AssignMul: {
+    val = ctx.builder.CreateMul(desti_val, value_val, "op.mul");
+  } break;
+
+  case AST::Expr::OpBinary::AssignDiv: {
+    val = ctx.builder.CreateSDiv(desti_val, value_val, "op.div");
+  } break;
+
+  case AST::Expr::OpBinary::AssignMod: {
+    val = ctx.builder.CreateSRem(desti_val, value_val, "op.mod");
+  } break;
+
+  default: {
+    throw std::logic_error("Compound assignment codegen on non-compound op");
+  } break;
+  }
+
+  ctx.builder.CreateStore(val, desti_ptr);
+
+  return val;
+}
+
 // Codegen for ptr + int
 llvm::Value *builder_ptr_add(Context &ctx, AST::ExprHandle ptr, AST::ExprHandle offset) {
 
@@ -381,6 +440,39 @@ llvm::Value *builder_mod(Context &ctx, const AST::Expr::Prim2 *expr, AST::Expr::
   return ctx.builder.CreateSRem(lhs_val, rhs_val, "op.mod");
 }
 
+// Codegen for && and ||, where the rhs is evaluated only if required, as in C.
+// With `is_and` the rhs is evaluated only if the lhs is true, otherwise only if the lhs is false.
+// The result is a phi over the value of the lhs which skipped the rhs, and the value of the rhs.
+llvm::Value *builder_short_circuit(Context &ctx, const AST::Expr::Prim2 *expr, bool is_and) {
+  llvm::Function *parent = ctx.builder.GetInsertBlock()->getParent();
+
+  llvm::Value *lhs_val = expr->lhs->codegen_eval_true(ctx);
+  llvm::BasicBlock *block_lhs = ctx.builder.GetInsertBlock();
+
+  llvm::BasicBlock *block_rhs = llvm::BasicBlock::Create(*ctx.context, is_and ? "and.rhs" : "or.rhs", parent);
+  llvm::BasicBlock *block_end = llvm::BasicBlock::Create(*ctx.context, is_and ? "and.end" : "or.end");
+
+  if (is_and) {
+    ctx.builder.CreateCondBr(lhs_val, block_rhs, block_end);
+  } else {
+    ctx.builder.CreateCondBr(lhs_val, block_end, block_rhs);
+  }
+
+  ctx.builder.SetInsertPoint(block_rhs);
+  llvm::Value *rhs_val = expr->rhs->codegen_eval_true(ctx);
+  block_rhs = ctx.builder.GetInsertBlock(); // The rhs may itself branch, e.g. if nested.
+  ctx.builder.CreateBr(block_end);
+
+  parent->insert(parent->end(), block_end);
+  ctx.builder.SetInsertPoint(block_end);
+
+  llvm::PHINode *phi = ctx.builder.CreatePHI(ctx.builder.getInt1Ty(), 2, is_and ? "op.and" : "op.or");
+  phi->addIncoming(ctx.builder.getInt1(!is_and), block_lhs);
+  phi->addIncoming(rhs_val, block_rhs);
+
+  return phi;
+}
+
 } // namespace OpBinaryCodegen
 
 llvm::Value *AST::Expr::Prim2::codegen(Context &ctx, AST::Expr::Value value) const {
@@ -391,24 +483,12 @@ llvm::Value *AST::Expr::Prim2::codegen(Context &ctx, AST::Expr::Value value) con
     return OpBinaryCodegen::builder_assign(ctx, this->lhs, this->rhs);
   } break;
 
-  case OpBinary::AssignAdd: {
-    throw std::logic_error("todo: +=");
-  } break;
-
-  case OpBinary::AssignSub: {
-    throw std::logic_error("todo: -=");
-  } break;
-
-  case OpBinary::AssignMul: {
-    throw std::logic_error("todo: *=");
-  } break;
-
-  case OpBinary::AssignDiv: {
-    throw std::logic_error("todo: /=");
-  } break;
-
+  case OpBinary::AssignAdd:
+  case OpBinary::AssignSub:
+  case OpBinary::AssignMul:
+  case OpBinary::AssignDiv:
   case OpBinary::AssignMod: {
-    throw std::logic_error("todo: %=");
+    return OpBinaryCodegen::builder_assign_compound(ctx, this);
   } break;
 
   case OpBinary::Add: {
@@ -491,30 +571,60 @@ llvm::Value *AST::Expr::Prim2::codegen(Context &ctx, AST::Expr::Value value) con
   } break;
 
   case OpBinary::And: {
-    auto lhs_val = this->lhs->codegen_eval_true(ctx);
-    auto rhs_val = this->rhs->codegen_eval_true(ctx);
-
-    return ctx.builder.CreateAnd(lhs_val, rhs_val, "op.and");
+    return OpBinaryCodegen::builder_short_circuit(ctx, this, true);
   } break;
 
   case OpBinary::Or: {
-    auto lhs_val = this->lhs->codegen_eval_true(ctx);
-    auto rhs_val = this->rhs->codegen_eval_true(ctx);
-
-    return ctx.builder.CreateOr(lhs_val, rhs_val, "op.or");
+    return OpBinaryCodegen::builder_short_circuit(ctx, this, false);
   } break;
   }
 }
 
+// Checks `index` is within `area`, calling the runtime fn `microc_bounds_fail` if not.
+//
+// The check is a single unsigned comparison, which also catches negative indices, with a branch to a cold, noreturn block.
+// This is the form of range check which IndVarSimplify may eliminate and IRCE may remove from loops.
+static void codegen_bounds_check(Context &ctx, llvm::Value *index, std::size_t area) {
+  llvm::Function *parent = ctx.builder.GetInsertBlock()->getParent();
+  auto int_typ = ctx.get_typ(AST::Typ::Kind::Int);
+
+  auto fail_typ = llvm::FunctionType::get(ctx.builder.getVoidTy(), {int_typ, int_typ}, false);
+  auto fail_fn = ctx.module->getOrInsertFunction("microc_bounds_fail", fail_typ);
+  auto fail_decl = llvm::cast<llvm::Function>(fail_fn.getCallee());
+  fail_decl->addFnAttr(llvm::Attribute::NoReturn);
+  fail_decl->addFnAttr(llvm::Attribute::NoUnwind);
+  fail_decl->addFnAttr(llvm::Attribute::Cold);
+
+  llvm::BasicBlock *block_fail = llvm::BasicBlock::Create(*ctx.context, "bounds.fail", parent);
+  llvm::BasicBlock *block_ok = llvm::BasicBlock::Create(*ctx.context, "bounds.ok", parent);
+
+  auto area_val = llvm::ConstantInt::get(int_typ, area);
+  auto in_bounds = ctx.builder.CreateICmpULT(index, area_val, "bounds.check");
+  auto weights = llvm::MDBuilder(*ctx.context).createBranchWeights(2000, 1);
+  ctx.builder.CreateCondBr(in_bounds, block_ok, block_fail, weights);
+
+  ctx.builder.SetInsertPoint(block_fail);
+  ctx.builder.CreateCall(fail_fn, {index, area_val});
+  ctx.builder.CreateUnreachable();
+
+  ctx.builder.SetInsertPoint(block_ok);
+  ctx.bounds_checks += 1;
+}
+
+// With `checked` codegen, indices into arrays with an area are checked.
 llvm::Value *AST::Expr::Index::codegen(Context &ctx, AST::Expr::Value value) const {
 
   llvm::Value *val;
 
-  auto as_ptr = std::static_pointer_cast<AST::Typ::Ptr>(this->target->typ());
+  auto as_ptr = static_cast<AST::Typ::Ptr *>(this->target->typ());
   if (as_ptr->area().has_value()) {
 
     auto index_val = this->index->codegen(ctx, AST::Expr::Value::R);
 
+    if (ctx.options.checked) {
+      codegen_bounds_check(ctx, index_val, as_ptr->area().value());
+    }
+
     std::vector<llvm::Value *> array_ref = {};
     if (as_ptr->area().has_value()) {
       array_ref.push_back(ctx.get_zero());
@@ -18,23 +18,24 @@
 //
 // Generation of statements stops immediately when a `return` statement is found.
 //
-// Codegen mutates the env with any declarations and restore the env on exit of the block.
+// Codegen binds any declarations in a scope of the env, and exits the scope (restoring the env) on exit of the block.
+//
+// The end of the lifetime of each local declared in the block is marked, if control reaches the end of the block.
+// With this, locals of disjoint scopes may share a stack slot.
 llvm::Value *AST::Stmt::Block::codegen(Context &ctx) const {
 
-  std::vector<std::pair<std::string, llvm::Value *>> shadowed_values{};
+  ctx.env_llvm.vars.enter();
 
   for (auto &fresh_dec : block.fresh_vars) {
     fresh_dec->codegen(ctx);
   }
 
   for (auto &shadow_dec : block.shadow_vars) {
-    auto var = shadow_dec->declaration->var();
-    auto x = std::make_pair(var, ctx.env_llvm.vars[var]);
-    shadowed_values.push_back(x);
-    auto y = shadow_dec->codegen(ctx);
+    shadow_dec->codegen(ctx);
   }
 
   for (auto &stmt : block.statements) {
+    ctx.set_debug_location(stmt->line);
     stmt->codegen(ctx);
 
     if (stmt->returns()) {
@@ -42,15 +43,17 @@ llvm::Value *AST::Stmt::Block::codegen(Context &ctx) const {
     }
   }
 
-  // Unshadow shadowed vars
-  for (auto &shadowed_var : shadowed_values) {
-    ctx.env_llvm.vars[shadowed_var.first] = shadowed_var.second;
+  if (!ctx.builder.GetInsertBlock()->getTerminator()) {
+    for (auto &dec : block.fresh_vars) {
+      ctx.end_lifetime(dec->declaration->symbol());
+    }
+    for (auto &dec : block.shadow_vars) {
+      ctx.end_lifetime(dec->declaration->symbol());
+    }
   }
 
-  // Clear fresh vars from scope
-  for (auto &fresh_var : block.fresh_vars) {
-    ctx.env_llvm.vars.erase(fresh_var->declaration->var());
-  }
+  // Clear fresh vars from scope, and unshadow shadowed vars
+  ctx.env_llvm.vars.exit();
 
   return ctx.stmt_return_val();
 }
@@ -91,6 +94,7 @@ llvm::Value *AST::Stmt::If::codegen(Context &ctx) const {
   }
 
   ctx.builder.SetInsertPoint(block_then);
+  ctx.count_site(ProfileSite::Kind::Then, this->line);
   llvm::Value *true_eval = this->stmt_then->codegen(ctx);
 
   if (!this->stmt_then->returns()) { //
@@ -100,6 +104,7 @@ llvm::Value *AST::Stmt::If::codegen(Context &ctx) const {
   if (block_else) {
     parent->insert(parent->end(), block_else);
     ctx.builder.SetInsertPoint(block_else);
+    ctx.count_site(ProfileSite::Kind::Else, this->line);
     llvm::Value *false_eval = this->stmt_else->codegen(ctx);
 
     if (!this->stmt_else->returns()) {
@@ -119,6 +124,10 @@ llvm::Value *AST::Stmt::If::codegen(Context &ctx) const {
 // This variable is empty otherwise.
 //
 // Note, in particular, nested blocks in an fn will all access the same return_alloca.
+//
+// The exception is a call in return position, which is returned directly as a tail call.
+// If the types of caller and callee match the call is `musttail`, and so runs in constant stack, otherwise `tail`.
+// Though, either may be removed by fn codegen, if some alloca of the fn escapes (see `Dec::Fn::codegen`).
 llvm::Value *AST::Stmt::Return::codegen(Context &ctx) const {
 
   // If the return has some value...
@@ -126,6 +135,21 @@ llvm::Value *AST::Stmt::Return::codegen(Context &ctx) const {
     // Ensure the return value is loaded
     auto return_val = this->value.value()->codegen(ctx, AST::Expr::Value::R);
 
+    llvm::Function *parent = ctx.builder.GetInsertBlock()->getParent();
+    if (this->value.value()->kind() == AST::Expr::Kind::Call &&
+        return_val->getType() == parent->getReturnType()) {
+      auto call = llvm::cast<llvm::CallInst>(return_val);
+
+      if (call->getFunctionType() == parent->getFunctionType()) {
+        call->setTailCallKind(llvm::CallInst::TCK_MustTail);
+      } else {
+        call->setTailCall();
+      }
+
+      ctx.builder.CreateRet(call);
+      return ctx.stmt_return_val();
+    }
+
     // Use a return allocatio if available, and break to the corresponding block
     if (ctx.env_llvm.return_alloca) {
       ctx.builder.CreateStore(return_val, ctx.env_llvm.return_alloca);
@@ -162,7 +186,9 @@ llvm::Value *AST::Stmt::While::codegen(Context &ctx) const {
   ctx.builder.SetInsertPoint(block_loop);
 
   this->body->codegen(ctx);
+  ctx.set_debug_location(this->line); // The back edge is part of the loop, rather than the last statement of the body.
   if (!this->body->returns()) { // If entered, the while body may return...
+    ctx.count_site(ProfileSite::Kind::Loop, this->line);
     ctx.builder.CreateBr(block_cond);
   }
 
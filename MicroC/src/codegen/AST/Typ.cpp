@@ -0,0 +1,19 @@
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Type.h"
+
+#include "AST/AST.hpp"
+#include "AST/Types.hpp"
+#include "codegen/Structs.hpp"
+
+// Typ
+
+// The representation made by the table is for the LLVM context of the table.
+// Partitions of partitioned codegen share the types of the first partition, though each has an LLVM context of its own.
+// So, for a partition the representation is rebuilt, rather than cached, as partitions are generated concurrently.
+llvm::Type *AST::TypT::codegen(Context &ctx) const {
+  if (this->llvm_typ && &this->llvm_typ->getContext() == ctx.context.get()) {
+    return this->llvm_typ;
+  }
+
+  return this->build(ctx);
+}
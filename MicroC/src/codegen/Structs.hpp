@@ -2,14 +2,17 @@
 
 #include <map>
 #include <string>
+#include <vector>
 
 #include "llvm/IR/DIBuilder.h"
 #include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
+#include "llvm/Target/TargetMachine.h"
 
 #include "AST/AST.hpp"
 #include "AST/Node/Dec.hpp"
+#include "AST/TypTable.hpp"
 
 // A primative function, linked to a module (somehow)
 struct FnPrimative {
@@ -23,10 +26,14 @@ struct FnPrimative {
   AST::VarTypVec args;
 
   // LLVM IR codegen for the function.
+  // A declaration, which is then given an `available_externally` definition with `define`.
   virtual llvm::Function *codegen(Context &ctx) const = 0;
 
-  // For the LLVM `addGlobalMapping` method.
-  // Currently unused.
+  // Defines the body of `fn`, a declaration of this function, as IR with `available_externally` linkage.
+  // Used by codegen, and by the JIT to restore the body in modules partitioned from the module of codegen.
+  virtual void define(llvm::Function *fn) const = 0;
+
+  // The address of the function in the runtime, which the JIT defines as an absolute symbol.
   virtual int64_t global_map_addr() const = 0;
 };
 
@@ -34,12 +41,13 @@ struct FnPrimative {
 // As with the EnvAST struct, this is mutated to maintain information about variables in scope, etc.
 // And, in particular, it is up to codegen methods to appropriately maintain the struct.
 // See codegen for blocks or fn declarations for examples of significant maintenance.
+// Scopes are entered and exited with the env of vars, see `AST/Env.hpp`.
 struct EnvLLVM {
   // variables in scope
-  std::map<std::string, llvm::Value *> vars{};
+  AST::Env<llvm::Value *> vars{};
 
   // fns in scope (as fns are global, this is each)
-  std::map<std::string, llvm::Function *> fns{};
+  AST::Env<llvm::Function *> fns{};
 
   // block designated for return codegen for fns, to pass control to
   llvm::BasicBlock *return_block{nullptr};
@@ -48,16 +56,77 @@ struct EnvLLVM {
   llvm::Value *return_alloca{nullptr};
 };
 
+// A site counted with `profile` codegen, in the order of counters.
+struct ProfileSite {
+  enum class Kind {
+    Fn,   // Entries to a fn.
+    Loop, // Back edges of a while, i.e. iterations.
+    Then, // Entries to the then arm of an if.
+    Else, // Entries to the else arm of an if.
+  };
+
+  Kind kind;
+
+  // The fn the site is in.
+  std::string fn;
+
+  // The line of the fn, loop, or if, or 0 if unknown.
+  size_t line;
+};
+
+// Options which change the code generated.
+struct CodegenOptions {
+  // Whether indices into arrays with an area are checked against the area.
+  bool checked{false};
+
+  // Whether line tables are generated, mapping instructions to lines of source.
+  bool debug_info{false};
+
+  // Whether fn entries, loop iterations, and if arms are counted.
+  bool profile{false};
+};
+
 // Objects and general methods for codegen.
 struct Context {
 
+  // The nodes and types of the AST, which are freed together with the context.
+  // First, so the arena outlives anything with a handle to a node.
+  AST::Arena arena{};
+
+  // The identifiers of the AST, interned by the scanner.
+  // Names viewed by nodes are held here, and so, as with the arena, the table outlives the nodes.
+  AST::Symbols symbols{};
+
   std::unique_ptr<llvm::LLVMContext> context;
   std::unique_ptr<llvm::Module> module;
   llvm::IRBuilder<> builder;
 
+  // The canonical types, made in `arena`, with representations in `context`.
+  AST::TypTable types{this->arena, *this};
+
   // See above.
   EnvLLVM env_llvm{};
 
+  CodegenOptions options{};
+
+  // Whether globals are defined, or only declared, as in all but the first partition of partitioned codegen.
+  bool define_globals{true};
+
+  // The count of bounds checks generated, with `checked` codegen.
+  size_t bounds_checks{0};
+
+  // Debug info, with `debug_info` codegen, and otherwise null.
+  // `di_scope` is the subprogram of the fn being generated, and null outside of a fn.
+  std::unique_ptr<llvm::DIBuilder> di_builder{nullptr};
+  llvm::DICompileUnit *di_unit{nullptr};
+  llvm::DIScope *di_scope{nullptr};
+
+  // With `profile` codegen, the sites counted, and the name of the array of counters, with a counter for each site.
+  // The counters of partitions are distinct, and so each partition has a name of its own.
+  std::vector<ProfileSite> profile_sites{};
+  std::string profile_counters_name{"microc.profile.counters"};
+  llvm::GlobalVariable *profile_counters{nullptr};
+
   // Fn / Prototype / Variable to type mapping maintained during parsing.
   // Empty before, keep after parsing.
   AST::EnvAST env_ast{};
@@ -75,21 +144,62 @@ struct Context {
     for (auto &foundation_elem : this->foundation_fn_map) {
       auto primative_fn = foundation_elem.second;
 
-      std::string pt_var = primative_fn->name;
+      AST::Symbol pt_var = this->symbols.intern(primative_fn->name);
       auto pt_args = primative_fn->args;
 
-      AST::Dec::Prototype pt(primative_fn->return_type, std::move(pt_var), std::move(pt_args));
-      AST::Dec::PrototypeHandle handle = std::make_shared<AST::Dec::Prototype>(pt);
-
-      this->env_ast.fns[primative_fn->name] = handle;
+      this->env_ast.fns.bind(pt_var, this->arena.make<AST::Dec::Prototype>(primative_fn->return_type,
+                                                                           pt_var,
+                                                                           this->symbols.name(pt_var),
+                                                                           std::move(pt_args)));
     }
   };
 
 
+  // Sets the triple and data layout of the module to those of `tm`.
+  // To be called before codegen, so sizes and alignment used during codegen match those of the target.
+  void set_target(const llvm::TargetMachine &tm) {
+    this->module->setTargetTriple(tm.getTargetTriple().str());
+    this->module->setDataLayout(tm.createDataLayout());
+  }
+
   // Populates the foundation fn map, to be called on initialisation of this.
   // Defined together with the fns.
   void populate_foundation_fn_map();
 
+  // Generates an entry fn `int name(int argc, char **argv)` which calls `main` with the arguments in `argv`, each read as an int.
+  // Missing arguments are zero, and the value returned is the value returned by `main`, or zero if `main` is void.
+  // Globals are reset on each call to the entry fn.
+  // Defined in `codegen/entry.cpp`.
+  llvm::Function *generate_entry(llvm::Function *main, std::string name);
+
+  // Debug info
+  // Line tables only, as the JIT uses these to attribute samples to source and there is no debugger support.
+  // Defined in `codegen/debug_info.cpp`.
+
+  // Start debug info for the module, with `file` the source.
+  void enable_debug_info(const std::string &file);
+
+  // Finish debug info for the module, to be called after codegen.
+  void finalize_debug_info();
+
+  // Attach a subprogram for `fn` to `fn`, starting at `line`, and make the subprogram the scope of locations.
+  void begin_fn_debug_info(llvm::Function *fn, size_t line);
+
+  // Clear the scope and location, at the end of a fn.
+  void end_fn_debug_info();
+
+  // Set the location of instructions created by `builder` to `line`, if within the scope of a fn and the line is known.
+  void set_debug_location(size_t line);
+
+  // Profile counters
+  // Defined in `codegen/profile_counters.cpp`.
+
+  // Count a site of `kind` at `line`, at the insertion point of `builder`, with `profile` codegen.
+  void count_site(ProfileSite::Kind kind, size_t line);
+
+  // Finish the array of counters, to be called after codegen, once the count of sites is known.
+  void finalize_profile_counters();
+
   // Canonical codegen types
   // Used with `codegen` on types, with the exception of pointers which capture area information.
   llvm::Type *get_typ(AST::Typ::Kind kind) {
@@ -130,6 +240,29 @@ struct Context {
   // Returns an zero of type int.
   llvm::Value *get_zero() { return llvm::ConstantInt::get(this->get_typ(AST::Typ::Kind::Int), 0); }
 
+  // Creates an alloca at the start of the entry block of the current fn, regardless of the insertion point.
+  // So, locals declared in loops use the same stack slot on each iteration, and are candidates for mem2reg / SROA.
+  llvm::AllocaInst *create_entry_alloca(llvm::Type *typ, const llvm::Twine &name) {
+    llvm::BasicBlock &entry = this->builder.GetInsertBlock()->getParent()->getEntryBlock();
+    llvm::IRBuilder<> entry_builder(&entry, entry.begin());
+
+    return entry_builder.CreateAlloca(typ, nullptr, name);
+  }
+
+  // The size of the allocation of `alloca`, for lifetime markers.
+  llvm::ConstantInt *alloca_size(llvm::AllocaInst *alloca) {
+    auto size = alloca->getAllocationSize(this->module->getDataLayout());
+    return this->builder.getInt64(size.value().getFixedValue());
+  }
+
+  // Marks the end of the lifetime of the local `var`, if `var` is a local.
+  void end_lifetime(AST::Symbol var) {
+    auto alloca = llvm::dyn_cast_or_null<llvm::AllocaInst>(this->env_llvm.vars.find(var));
+    if (alloca) {
+      this->builder.CreateLifetimeEnd(alloca, this->alloca_size(alloca));
+    }
+  }
+
   // The return value for a statement.
   // As inaccessible, a null value of void type.
   llvm::Value *stmt_return_val() {
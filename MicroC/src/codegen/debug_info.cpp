@@ -0,0 +1,73 @@
+#include "llvm/BinaryFormat/Dwarf.h"
+#include "llvm/IR/DIBuilder.h"
+#include "llvm/IR/DebugInfoMetadata.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/Path.h"
+
+#include "codegen/Structs.hpp"
+
+// Debug info is limited to line tables.
+// Each fn has a subprogram, and each statement sets the location of the instructions generated for the statement.
+// Expressions take the location of the enclosing statement, which is as precise as the AST records.
+//
+// With a subprogram attached, optimisation passes keep (or merge) locations, and so the line tables also hold for optimised code.
+
+void Context::enable_debug_info(const std::string &file) {
+  this->di_builder = std::make_unique<llvm::DIBuilder>(*this->module);
+
+  auto di_file = this->di_builder->createFile(llvm::sys::path::filename(file),
+                                              llvm::sys::path::parent_path(file));
+
+  this->di_unit = this->di_builder->createCompileUnit(llvm::dwarf::DW_LANG_C,
+                                                      di_file,
+                                                      "microC",
+                                                      false,
+                                                      "",
+                                                      0,
+                                                      "",
+                                                      llvm::DICompileUnit::LineTablesOnly);
+
+  this->module->addModuleFlag(llvm::Module::Warning, "Debug Info Version", llvm::DEBUG_METADATA_VERSION);
+  this->module->addModuleFlag(llvm::Module::Warning, "Dwarf Version", 4);
+}
+
+void Context::finalize_debug_info() {
+  if (this->di_builder) {
+    this->di_builder->finalize();
+  }
+}
+
+void Context::begin_fn_debug_info(llvm::Function *fn, size_t line) {
+  if (!this->di_builder) {
+    return;
+  }
+
+  // Types are omitted from line tables, so each fn has an empty subroutine type.
+  auto fn_typ = this->di_builder->createSubroutineType(this->di_builder->getOrCreateTypeArray({}));
+
+  auto subprogram = this->di_builder->createFunction(this->di_unit,
+                                                     fn->getName(),
+                                                     fn->getName(),
+                                                     this->di_unit->getFile(),
+                                                     line,
+                                                     fn_typ,
+                                                     line,
+                                                     llvm::DINode::FlagPrototyped,
+                                                     llvm::DISubprogram::SPFlagDefinition);
+  fn->setSubprogram(subprogram);
+
+  this->di_scope = subprogram;
+  this->set_debug_location(line);
+}
+
+void Context::end_fn_debug_info() {
+  // Cleared, as a location outside of the scope of a fn (e.g. in the entry fn) fails verification.
+  this->di_scope = nullptr;
+  this->builder.SetCurrentDebugLocation(llvm::DebugLoc());
+}
+
+void Context::set_debug_location(size_t line) {
+  if (this->di_scope && line != 0) {
+    this->builder.SetCurrentDebugLocation(llvm::DILocation::get(*this->context, line, 0, this->di_scope));
+  }
+}
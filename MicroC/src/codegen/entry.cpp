@@ -0,0 +1,78 @@
+#include <format>
+#include <vector>
+
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+#include "codegen/Structs.hpp"
+
+// The entry fn has the signature of a C main, and so may be called by a C runtime, or by `runAsMain` of ORC.
+//
+// Arguments are read through `microc_arg` of the runtime, which avoids building a loop over `argv` in IR.
+// And, with this, the entry fn is a sequence of calls.
+//
+// Globals are reset to their initial values on entry, so repeated calls to the entry fn are independent.
+llvm::Function *Context::generate_entry(llvm::Function *main, std::string name) {
+
+  auto i32_typ = llvm::Type::getInt32Ty(*this->context);
+  auto int_typ = this->get_typ(AST::Typ::Kind::Int);
+  auto ptr_typ = this->get_typ(AST::Typ::Kind::Ptr);
+
+  // The runtime fn to read an argument.
+  auto arg_typ = llvm::FunctionType::get(int_typ, {i32_typ, ptr_typ, int_typ}, false);
+  auto arg_fn = this->module->getOrInsertFunction("microc_arg", arg_typ);
+
+  auto entry_typ = llvm::FunctionType::get(i32_typ, {i32_typ, ptr_typ}, false);
+  auto entry = llvm::Function::Create(entry_typ, llvm::Function::ExternalLinkage, name, this->module.get());
+
+  auto argc = entry->getArg(0);
+  auto argv = entry->getArg(1);
+  argc->setName("argc");
+  argv->setName("argv");
+
+  llvm::IRBuilder<> builder(llvm::BasicBlock::Create(*this->context, "entry", entry));
+
+  // Zero initialised globals (notably arrays) are cleared with a memset, others stored to.
+  // Globals of the compiler (e.g. profile counters) are prefixed with `microc.`, and kept over runs.
+  const llvm::DataLayout &data_layout = this->module->getDataLayout();
+  for (auto &global : this->module->globals()) {
+    if (!global.hasInitializer() || global.isConstant() || global.getName().starts_with("microc.")) {
+      continue;
+    }
+
+    auto init = global.getInitializer();
+    if (init->isNullValue()) {
+      auto size = data_layout.getTypeAllocSize(init->getType());
+      builder.CreateMemSet(&global, builder.getInt8(0), size.getFixedValue(), global.getAlign());
+    } else {
+      builder.CreateStore(init, &global);
+    }
+  }
+
+  // Argument zero is the program name, so the arguments to main start at one.
+  std::vector<llvm::Value *> main_args{};
+  for (auto &arg : main->args()) {
+    if (arg.getType() != int_typ) {
+      throw std::logic_error(std::format("Arguments to main must be int, found: {}", arg.getName().str()));
+    }
+
+    auto index = llvm::ConstantInt::get(int_typ, main_args.size() + 1);
+    main_args.push_back(builder.CreateCall(arg_fn, {argc, argv, index}, std::format("arg.{}", arg.getName().str())));
+  }
+
+  auto result = builder.CreateCall(main, main_args);
+
+  // The exit code is the value returned by main, if any.
+  if (main->getReturnType()->isVoidTy()) {
+    builder.CreateRet(llvm::ConstantInt::get(i32_typ, 0));
+  } else if (main->getReturnType() == int_typ) {
+    builder.CreateRet(builder.CreateTrunc(result, i32_typ, "exit_code"));
+  } else {
+    throw std::logic_error("The return type of main must be int or void");
+  }
+
+  return entry;
+}
@@ -2,35 +2,127 @@
 
 #include "llvm/ADT/ArrayRef.h"
 #include "llvm/IR/DIBuilder.h"
+#include "llvm/IR/IRBuilder.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 
 #include "AST/AST.hpp"
 #include "AST/Types.hpp"
 #include "Structs.hpp"
+#include "runtime/primatives.h"
 
 // Contents:
-// - Foundation fns in lexicographic order, as extern / FnPrimative pairings.
+// - Support for IR definitions of foundation fns.
+// - Foundation fns in lexicographic order, as FnPrimative structs.
+//   The fns are defined in the runtime, see `runtime/primatives.h`, and mirrored here as IR.
 // - Specification of the foundation fn map.
+//
+// Foundation fns are `nounwind` and `willreturn`, so attributes may be inferred for fns which call them.
+//
+// The IR definition of a foundation fn has `available_externally` linkage.
+// So, calls may be inlined, while the definition is never emitted and calls which are not inlined resolve to the runtime.
+// The IR and C definitions should be kept in sync, as which definition is used depends on the optimiser.
 
-// Foundation fns
+// Support
 
-// printi
+// The runtime output buffer, declared in `module`.
+static llvm::GlobalVariable *runtime_out_buf(llvm::Module &module) {
+  auto typ = llvm::ArrayType::get(llvm::Type::getInt8Ty(module.getContext()), MICROC_OUT_CAPACITY);
+  module.getOrInsertGlobal("microc_out_buf", typ);
+  return module.getNamedGlobal("microc_out_buf");
+}
+
+// The count of bytes in the runtime output buffer, declared in `module`.
+static llvm::GlobalVariable *runtime_out_len(llvm::Module &module) {
+  auto typ = module.getDataLayout().getIntPtrType(module.getContext());
+  module.getOrInsertGlobal("microc_out_len", typ);
+  return module.getNamedGlobal("microc_out_len");
+}
 
-extern "C" {
-void printi(int64_t i) {
-  printf("%lld ", i);
+// The runtime fn to write the output buffer, declared in `module`.
+static llvm::FunctionCallee runtime_flush(llvm::Module &module) {
+  auto typ = llvm::FunctionType::get(llvm::Type::getVoidTy(module.getContext()), false);
+  auto callee = module.getOrInsertFunction("microc_flush", typ);
+  llvm::cast<llvm::Function>(callee.getCallee())->addFnAttr(llvm::Attribute::NoUnwind);
+  return callee;
 }
+
+// Ensures there is space for `bytes` in the output buffer, flushing the buffer if not.
+// The builder is left at a fresh block, and the returned value is the count of bytes in the buffer, from that block.
+static llvm::Value *reserve_output(llvm::IRBuilder<> &builder, uint64_t bytes) {
+  llvm::Function *fn = builder.GetInsertBlock()->getParent();
+  llvm::Module &module = *fn->getParent();
+  llvm::LLVMContext &context = fn->getContext();
+
+  auto len = runtime_out_len(module);
+  auto len_typ = len->getValueType();
+
+  llvm::BasicBlock *block_flush = llvm::BasicBlock::Create(context, "flush", fn);
+  llvm::BasicBlock *block_write = llvm::BasicBlock::Create(context, "write", fn);
+
+  auto len_val = builder.CreateLoad(len_typ, len, "len");
+  auto full = builder.CreateICmpUGT(len_val, llvm::ConstantInt::get(len_typ, MICROC_OUT_CAPACITY - bytes), "full");
+  builder.CreateCondBr(full, block_flush, block_write);
+
+  builder.SetInsertPoint(block_flush);
+  builder.CreateCall(runtime_flush(module));
+  builder.CreateBr(block_write);
+
+  builder.SetInsertPoint(block_write);
+  return builder.CreateLoad(len_typ, len, "at");
 }
 
+// Foundation fns
+
+// flush
+
+// Writes any buffered output.
+// Output is otherwise written when the buffer fills, and on exit.
+struct Flush : FnPrimative {
+
+  Flush(AST::TypTable &types) {
+    this->name = "flush";
+    this->return_type = types.pk_Void();
+    this->args = AST::VarTypVec{};
+  }
+
+  llvm::Function *codegen(Context &ctx) const override {
+    auto typ = llvm::FunctionType::get(llvm::Type::getVoidTy(*ctx.context), false);
+
+    auto fn = llvm::Function::Create(typ, llvm::Function::ExternalLinkage, this->name, ctx.module.get());
+    fn->setCallingConv(llvm::CallingConv::C);
+    fn->addFnAttr(llvm::Attribute::NoUnwind);
+    fn->addFnAttr(llvm::Attribute::WillReturn);
+
+    this->define(fn);
+
+    return fn;
+  }
+
+  void define(llvm::Function *fn) const override {
+    llvm::IRBuilder<> builder(llvm::BasicBlock::Create(fn->getContext(), "entry", fn));
+
+    builder.CreateCall(runtime_flush(*fn->getParent()));
+    builder.CreateRetVoid();
+
+    fn->setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+  }
+
+  int64_t global_map_addr() const override { return (int64_t)(flush); };
+};
+
+// printi
+
 // Prints an integer.
 // Equivalent to the `print` statement in microC of PLC, with each `print` parsed to a `printi` call.
 struct PrintI : FnPrimative {
 
-  PrintI() {
+  PrintI(AST::TypTable &types, AST::Symbols &symbols) {
     this->name = "printi";
-    this->return_type = std::make_shared<AST::Typ::Void>(AST::Typ::Void());
-    this->args = AST::VarTypVec{{"n", AST::Typ::pk_Int()}};
+    this->return_type = types.pk_Void();
+
+    AST::Symbol n = symbols.intern("n");
+    this->args = AST::VarTypVec{{n, symbols.name(n), types.pk_Int()}};
   }
 
   llvm::Function *codegen(Context &ctx) const override {
@@ -38,28 +130,90 @@ struct PrintI : FnPrimative {
 
     auto fn = llvm::Function::Create(typ, llvm::Function::ExternalLinkage, this->name, ctx.module.get());
     fn->setCallingConv(llvm::CallingConv::C);
+    fn->addFnAttr(llvm::Attribute::NoUnwind);
+    fn->addFnAttr(llvm::Attribute::WillReturn);
+
+    this->define(fn);
 
     return fn;
   }
 
+  // As in the runtime, digits are written from the end of a scratch buffer, which is then copied to the output buffer.
+  // The magnitude is unsigned, as the magnitude of the least int is not an int.
+  void define(llvm::Function *fn) const override {
+    llvm::LLVMContext &context = fn->getContext();
+    llvm::Module &module = *fn->getParent();
+
+    const uint64_t scratch_size = 21; // The longest int, and a separator.
+
+    llvm::IRBuilder<> builder(llvm::BasicBlock::Create(context, "entry", fn));
+
+    auto i8_typ = builder.getInt8Ty();
+    auto scratch = builder.CreateAlloca(llvm::ArrayType::get(i8_typ, scratch_size), nullptr, "scratch");
+
+    auto at = reserve_output(builder, scratch_size);
+    auto len_typ = at->getType();
+    llvm::BasicBlock *block_write = builder.GetInsertBlock();
+
+    auto n = fn->getArg(0);
+    auto negative = builder.CreateICmpSLT(n, llvm::ConstantInt::get(n->getType(), 0), "negative");
+    auto magnitude = builder.CreateSelect(negative, builder.CreateNeg(n), n, "magnitude");
+
+    auto end = llvm::ConstantInt::get(len_typ, scratch_size - 1);
+    builder.CreateStore(builder.getInt8(' '), builder.CreateInBoundsGEP(i8_typ, scratch, end));
+
+    llvm::BasicBlock *block_digit = llvm::BasicBlock::Create(context, "digit", fn);
+    llvm::BasicBlock *block_copy = llvm::BasicBlock::Create(context, "copy", fn);
+    builder.CreateBr(block_digit);
+
+    // One digit per iteration, from least to most significant.
+    builder.SetInsertPoint(block_digit);
+    auto pos = builder.CreatePHI(len_typ, 2, "pos");
+    auto rest = builder.CreatePHI(n->getType(), 2, "rest");
+
+    auto pos_next = builder.CreateSub(pos, llvm::ConstantInt::get(len_typ, 1), "pos.next");
+    auto digit = builder.CreateURem(rest, llvm::ConstantInt::get(n->getType(), 10), "digit");
+    auto digit_char = builder.CreateAdd(builder.CreateTrunc(digit, i8_typ), builder.getInt8('0'), "digit.char");
+    builder.CreateStore(digit_char, builder.CreateInBoundsGEP(i8_typ, scratch, pos_next));
+    auto rest_next = builder.CreateUDiv(rest, llvm::ConstantInt::get(n->getType(), 10), "rest.next");
+
+    auto more = builder.CreateICmpNE(rest_next, llvm::ConstantInt::get(n->getType(), 0), "more");
+    builder.CreateCondBr(more, block_digit, block_copy);
+
+    pos->addIncoming(end, block_write);
+    pos->addIncoming(pos_next, block_digit);
+    rest->addIncoming(magnitude, block_write);
+    rest->addIncoming(rest_next, block_digit);
+
+    // The sign is always written, though only copied if negative.
+    builder.SetInsertPoint(block_copy);
+    auto sign_pos = builder.CreateSub(pos_next, llvm::ConstantInt::get(len_typ, 1), "sign.pos");
+    builder.CreateStore(builder.getInt8('-'), builder.CreateInBoundsGEP(i8_typ, scratch, sign_pos));
+    auto start = builder.CreateSelect(negative, sign_pos, pos_next, "start");
+    auto count = builder.CreateSub(llvm::ConstantInt::get(len_typ, scratch_size), start, "count");
+
+    auto buf = runtime_out_buf(module);
+    builder.CreateMemCpy(builder.CreateInBoundsGEP(i8_typ, buf, at), llvm::MaybeAlign(1),
+                         builder.CreateInBoundsGEP(i8_typ, scratch, start), llvm::MaybeAlign(1),
+                         count);
+    builder.CreateStore(builder.CreateAdd(at, count), runtime_out_len(module));
+    builder.CreateRetVoid();
+
+    fn->setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+  }
+
   int64_t global_map_addr() const override { return (int64_t)(printi); };
 };
 
 // println
-extern "C" {
-
-void println() {
-  printf("\n");
-}
-}
 
 // Prints a new line.
 // Equivalent to the `println` statement in microC of PLC, with each `println` parsed to a `println` call.
 struct PrintLn : FnPrimative {
 
-  PrintLn() {
+  PrintLn(AST::TypTable &types) {
     this->name = "println";
-    this->return_type = std::make_shared<AST::Typ::Void>(AST::Typ::Void());
+    this->return_type = types.pk_Void();
     this->args = AST::VarTypVec{};
   }
 
@@ -68,19 +222,40 @@ struct PrintLn : FnPrimative {
 
     auto fn = llvm::Function::Create(typ, llvm::Function::ExternalLinkage, "println", ctx.module.get());
     fn->setCallingConv(llvm::CallingConv::C);
+    fn->addFnAttr(llvm::Attribute::NoUnwind);
+    fn->addFnAttr(llvm::Attribute::WillReturn);
+
+    this->define(fn);
 
     return fn;
   }
 
+  void define(llvm::Function *fn) const override {
+    llvm::Module &module = *fn->getParent();
+
+    llvm::IRBuilder<> builder(llvm::BasicBlock::Create(fn->getContext(), "entry", fn));
+
+    auto at = reserve_output(builder, 1);
+
+    auto buf = runtime_out_buf(module);
+    builder.CreateStore(builder.getInt8('\n'), builder.CreateInBoundsGEP(builder.getInt8Ty(), buf, at));
+    builder.CreateStore(builder.CreateAdd(at, llvm::ConstantInt::get(at->getType(), 1)), runtime_out_len(module));
+    builder.CreateRetVoid();
+
+    fn->setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+  }
+
   int64_t global_map_addr() const override { return (int64_t)(println); };
 };
 
 // Specification of the foundation fn map
 void Context::populate_foundation_fn_map() {
 
-  auto printi = std::make_shared<PrintI>(PrintI());
-  auto println = std::make_shared<PrintLn>(PrintLn());
+  auto flush = std::make_shared<Flush>(this->types);
+  auto printi = std::make_shared<PrintI>(this->types, this->symbols);
+  auto println = std::make_shared<PrintLn>(this->types);
 
+  this->foundation_fn_map[flush->name] = flush;
   this->foundation_fn_map[printi->name] = printi;
   this->foundation_fn_map[println->name] = println;
 }
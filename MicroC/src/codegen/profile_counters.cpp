@@ -0,0 +1,56 @@
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Module.h"
+
+#include "codegen/Structs.hpp"
+
+// Each site has a counter in a single array, indexed by the position of the site in `profile_sites`.
+//
+// The count of sites is only known after codegen, and so counters are addressed through a placeholder global during codegen.
+// With opaque pointers the type of a global is not part of a pointer to it, and so the placeholder is then replaced by an array of the right size.
+//
+// Counters are plain loads and stores, so counts may be lost if fns are run on many threads, though microC is single threaded.
+
+void Context::count_site(ProfileSite::Kind kind, size_t line) {
+  if (!this->options.profile) {
+    return;
+  }
+
+  auto i64_typ = llvm::Type::getInt64Ty(*this->context);
+
+  if (!this->profile_counters) {
+    this->profile_counters = new llvm::GlobalVariable(*this->module,
+                                                      i64_typ,
+                                                      false,
+                                                      llvm::GlobalValue::ExternalLinkage,
+                                                      nullptr,
+                                                      this->profile_counters_name + ".placeholder");
+  }
+
+  std::string fn = this->builder.GetInsertBlock()->getParent()->getName().str();
+  size_t index = this->profile_sites.size();
+  this->profile_sites.push_back(ProfileSite{kind, fn, line});
+
+  auto counter = this->builder.CreateConstInBoundsGEP1_64(i64_typ, this->profile_counters, index, "profile.counter");
+  auto count = this->builder.CreateLoad(i64_typ, counter);
+  this->builder.CreateStore(this->builder.CreateAdd(count, this->builder.getInt64(1), "profile.count"), counter);
+}
+
+void Context::finalize_profile_counters() {
+  if (!this->profile_counters) {
+    return;
+  }
+
+  auto counters_typ = llvm::ArrayType::get(llvm::Type::getInt64Ty(*this->context), this->profile_sites.size());
+  auto counters = new llvm::GlobalVariable(*this->module,
+                                           counters_typ,
+                                           false,
+                                           llvm::GlobalValue::ExternalLinkage,
+                                           llvm::ConstantAggregateZero::get(counters_typ),
+                                           this->profile_counters_name);
+
+  this->profile_counters->replaceAllUsesWith(counters);
+  this->profile_counters->eraseFromParent();
+  this->profile_counters = counters;
+}
@@ -20,6 +20,9 @@
 
 %param { Driver& driver } // Parsing context
 
+// The C++ parser is pure (`api.pure` is for C parsers), with state held by the parser and the driver.
+// So, with the reentrant scanner, drivers may parse concurrently.
+
 %locations
 
 %define parse.trace
@@ -43,7 +46,8 @@
 %define api.token.prefix {TOK_}
 
 %token <int> CSTINT CSTBOOL
-%token <std::string> CSTSTRING NAME
+%token <std::string> CSTSTRING
+%token <AST::Symbol> NAME
 
 %token
   CHAR ELSE IF INT NULL PRINT PRINTLN RETURN VOID WHILE FOR
@@ -126,21 +130,21 @@ AtomicConst:
 
 
 DataType:
-    INT   { $$ = AST::Typ::pk_Int();  }
-  | CHAR  { $$ = AST::Typ::pk_Char(); }
+    INT   { $$ = driver.ctx.types.pk_Int();  }
+  | CHAR  { $$ = driver.ctx.types.pk_Char(); }
 ;
 
 
 
 Exprs:
     %empty   { $$ = std::vector<AST::ExprHandle>(); }
-  | ExprsNE  { $$ = $1;                             }
+  | ExprsNE  { $$ = std::move($1);                  }
 ;  
 
 
 ExprsNE:
-    Expr                { std::vector<AST::ExprHandle> es{$1}; $$ = es; }
-  | ExprsNE COMMA Expr  { $1.push_back($3);                    $$ = $1; }
+    Expr                { $$ = std::vector<AST::ExprHandle>{$1}; }
+  | ExprsNE COMMA Expr  { $1.push_back($3); $$ = std::move($1); }
 ;  
 
 
@@ -153,13 +157,13 @@ Expr:
   | Expr STAR_ASSIGN Expr     { $$ = driver.pk_ExprPrim2(AST::Expr::OpBinary::AssignMul, $1, $3); }
   | Expr SLASH_ASSIGN Expr    { $$ = driver.pk_ExprPrim2(AST::Expr::OpBinary::AssignDiv, $1, $3); }
   | Expr MOD_ASSIGN Expr      { $$ = driver.pk_ExprPrim2(AST::Expr::OpBinary::AssignMod, $1, $3); }
-  | NAME LPAR Exprs RPAR      { $$ = driver.pk_ExprCall($1, $3);                                  }
+  | NAME LPAR Exprs RPAR      { $$ = driver.pk_ExprCall($1, std::move($3));                       }
   | MINUS Expr                { $$ = driver.pk_ExprPrim1(AST::Expr::OpUnary::Sub, $2);            }
   | AMP Expr                  { $$ = driver.pk_ExprPrim1(AST::Expr::OpUnary::AddressOf, $2);      }
   | STAR Expr                 { $$ = driver.pk_ExprPrim1(AST::Expr::OpUnary::Dereference, $2);    }
   | NOT Expr                  { $$ = driver.pk_ExprPrim1(AST::Expr::OpUnary::Negation, $2);       }
-  | PRINT Expr                { $$ = driver.pk_ExprCall("printi", $2);                            }
-  | PRINTLN                   { $$ = driver.pk_ExprCall("println");                               }
+  | PRINT Expr                { $$ = driver.pk_ExprCall(driver.ctx.symbols.intern("printi"), $2); }
+  | PRINTLN                   { $$ = driver.pk_ExprCall(driver.ctx.symbols.intern("println"));   }
   | Expr PLUS  Expr           { $$ = driver.pk_ExprPrim2(AST::Expr::OpBinary::Add,  $1, $3);      }
   | Expr MINUS Expr           { $$ = driver.pk_ExprPrim2(AST::Expr::OpBinary::Sub,  $1, $3);      }
   | Expr STAR  Expr           { $$ = driver.pk_ExprPrim2(AST::Expr::OpBinary::Mul,  $1, $3);      }
@@ -181,16 +185,16 @@ Expr:
 FnPrototype:
     VOID NAME LPAR Paramdecs RPAR      {
       driver.add_to_env($4);
-      $$ = driver.pk_Prototype(AST::Typ::pk_Void(), $2, $4); }
+      $$ = driver.located(driver.pk_Prototype(driver.ctx.types.pk_Void(), $2, std::move($4)), @$); }
   | DataType NAME LPAR Paramdecs RPAR  {
       driver.add_to_env($4);
-      $$ = driver.pk_Prototype($1, $2, $4);                  }
+      $$ = driver.located(driver.pk_Prototype($1, $2, std::move($4)), @$);                  }
 ;
 
 Fndec:
     FnPrototype Block      {
       auto r = driver.pk_DecFn($1, $2);
-      driver.fn_finalise(r);
+      driver.fn_finalise();
       $$ = r;
     }
 ;
@@ -198,13 +202,13 @@ Fndec:
 
 Paramdecs:
     %empty       { $$ = AST::VarTypVec{}; }
-  | ParamdecsNE  { $$ = $1;              }
+  | ParamdecsNE  { $$ = std::move($1);   }
 ;
 
 
 ParamdecsNE:
-    Vardec                    { $$ = AST::VarTypVec{$1};      }
-  | ParamdecsNE COMMA Vardec  { $1.push_back($3); $$ = $1; }
+    Vardec                    { $$ = AST::VarTypVec{$1};                 }
+  | ParamdecsNE COMMA Vardec  { $1.push_back($3); $$ = std::move($1); }
 ;
 
 
@@ -215,30 +219,31 @@ Stmt:
 
 
 StmtA:  /* No unbalanced if-else */
-    Expr SEMI                           { $$ = driver.pk_StmtExpr($1);                   }
-  | RETURN SEMI                         { $$ = driver.pk_StmtReturn(std::nullopt);       }
-  | RETURN Expr SEMI                    { $$ = driver.pk_StmtReturn($2);                 }
-  | Block                               { $$ = std::static_pointer_cast<AST::StmtT>($1); }
-  | IF LPAR Expr RPAR StmtA ELSE StmtA  { $$ = driver.pk_StmtIf($3, $5, $7);             }
-  | WHILE LPAR Expr RPAR StmtA          { $$ = driver.pk_StmtWhile($3, $5);              }
+    Expr SEMI                           { $$ = driver.located(driver.pk_StmtExpr($1), @$);             }
+  | RETURN SEMI                         { $$ = driver.located(driver.pk_StmtReturn(std::nullopt), @$); }
+  | RETURN Expr SEMI                    { $$ = driver.located(driver.pk_StmtReturn($2), @$);           }
+  | Block                               { $$ = $1;                                                    }
+  | IF LPAR Expr RPAR StmtA ELSE StmtA  { $$ = driver.located(driver.pk_StmtIf($3, $5, $7), @$);       }
+  | WHILE LPAR Expr RPAR StmtA          { $$ = driver.located(driver.pk_StmtWhile($3, $5), @$);        }
 ;
 
 
 StmtB:
-    IF LPAR Expr RPAR StmtA ELSE StmtB  { $$ = driver.pk_StmtIf($3, $5, $7); }
+    IF LPAR Expr RPAR StmtA ELSE StmtB  { $$ = driver.located(driver.pk_StmtIf($3, $5, $7), @$); }
   | IF LPAR Expr RPAR Stmt              {
       auto empty_block = driver.pk_StmtBlockStmt(AST::Block{});
-      $$ = driver.pk_StmtIf($3, $5, empty_block);                            }
-  | WHILE LPAR Expr RPAR StmtB          { $$ = driver.pk_StmtWhile($3, $5);  }
+      $$ = driver.located(driver.pk_StmtIf($3, $5, empty_block), @$);        }
+  | WHILE LPAR Expr RPAR StmtB          { $$ = driver.located(driver.pk_StmtWhile($3, $5), @$); }
 ;
 
 
 StmtOrDecSeq:
-    %empty                    { $$ = AST::Block{};                              }
-  | StmtOrDecSeq Stmt         { $1.push_Stmt($2); $$ = $1;                      }
+    %empty                    { driver.ctx.env_ast.vars.enter(); $$ = AST::Block{}; }
+  | StmtOrDecSeq Stmt         { $1.push_Stmt($2); $$ = std::move($1);           }
   | StmtOrDecSeq Vardec SEMI  {
-      auto dec = driver.pk_DecVar(AST::Dec::Scope::Local, $2.typ, $2.var);
-      $$ = $1.push_DecVar(driver.ctx.env_ast, driver.pk_StmtDeclaration(dec)); }
+      auto dec = driver.pk_DecVar(AST::Dec::Scope::Local, $2.typ, $2.sym);
+      $1.push_DecVar(driver.ctx.env_ast, driver.pk_StmtDeclaration(dec));
+      $$ = std::move($1);                                                   }
 ;
 
 
@@ -250,30 +255,30 @@ Topdecs:
 
 Topdec:
    Vardec SEMI  {
-     auto dec = driver.pk_DecVar(AST::Dec::Scope::Global, $1.typ, $1.var);
+     auto dec = driver.pk_DecVar(AST::Dec::Scope::Global, $1.typ, $1.sym);
      driver.push_dec(driver.pk_StmtDeclaration(dec));                      }
   | Fndec       { driver.push_dec(driver.pk_StmtDeclaration($1));          }
 ;
 
 
 Vardec:
-    DataType Vardesc  { $$ = AST::VarTyp($2.var, $2.typ->complete_with($1)); }
+    DataType Vardesc  { $$ = AST::VarTyp($2.sym, $2.var, $2.typ->complete_with(driver.ctx.types, $1)); }
 ;
 
 
 Vardesc:
-    NAME                          { $$ = AST::VarTyp($1, AST::Typ::pk_Void());                        }
+    NAME                          { $$ = AST::VarTyp($1, driver.ctx.symbols.name($1), driver.ctx.types.pk_Void()); }
   | STAR Vardesc                  {
-      auto fresh = AST::Typ::pk_Ptr(AST::Typ::pk_Void(), std::nullopt);
-      $$ = AST::VarTyp($2.var, $2.typ->complete_with(fresh));
+      auto fresh = driver.ctx.types.pk_Ptr(driver.ctx.types.pk_Void(), std::nullopt);
+      $$ = AST::VarTyp($2.sym, $2.var, $2.typ->complete_with(driver.ctx.types, fresh));
     }
   | Vardesc LBRACK RBRACK         {
-      auto fresh = AST::Typ::pk_Ptr(AST::Typ::pk_Void(), std::nullopt);
-      $$ = AST::VarTyp($1.var, $1.typ->complete_with(fresh));
+      auto fresh = driver.ctx.types.pk_Ptr(driver.ctx.types.pk_Void(), std::nullopt);
+      $$ = AST::VarTyp($1.sym, $1.var, $1.typ->complete_with(driver.ctx.types, fresh));
     }
   | Vardesc LBRACK CSTINT RBRACK  {
-      auto fresh = AST::Typ::pk_Ptr(AST::Typ::pk_Void(), $3);
-      $$ = AST::VarTyp($1.var, $1.typ->complete_with(fresh));
+      auto fresh = driver.ctx.types.pk_Ptr(driver.ctx.types.pk_Void(), $3);
+      $$ = AST::VarTyp($1.sym, $1.var, $1.typ->complete_with(driver.ctx.types, fresh));
     }
   | LPAR Vardesc RPAR             { $$ = $2;                                                          }
 ;
@@ -0,0 +1,92 @@
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "runtime/primatives.h"
+
+// Output is written to a buffer, which is written to stdout when full, on `microc_flush`, and on exit.
+// This avoids the locking and format parsing of stdio for each value printed.
+
+// Enough for the longest int, and a separator.
+#define MICROC_INT_CHARS 21
+
+char microc_out_buf[MICROC_OUT_CAPACITY];
+size_t microc_out_len = 0;
+
+void microc_flush(void) {
+  size_t written = 0;
+
+  while (written < microc_out_len) {
+    ssize_t count = write(STDOUT_FILENO, microc_out_buf + written, microc_out_len - written);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    written += (size_t)count;
+  }
+
+  microc_out_len = 0;
+}
+
+// Registered on load, so output is written on exit from both microCJIT and executables from microCC.
+__attribute__((constructor)) static void microc_register_flush(void) {
+  atexit(microc_flush);
+}
+
+void printi(int64_t i) {
+  if (MICROC_OUT_CAPACITY < microc_out_len + MICROC_INT_CHARS) {
+    microc_flush();
+  }
+
+  // Digits are written from the end of a scratch buffer, as the count of digits is not known in advance.
+  // The magnitude is taken as unsigned, as the magnitude of the least int is not an int.
+  char digits[MICROC_INT_CHARS];
+  char *end = digits + MICROC_INT_CHARS;
+  char *start = end;
+
+  *--start = ' ';
+
+  uint64_t magnitude = i < 0 ? -(uint64_t)i : (uint64_t)i;
+  do {
+    *--start = (char)('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+
+  if (i < 0) {
+    *--start = '-';
+  }
+
+  memcpy(microc_out_buf + microc_out_len, start, (size_t)(end - start));
+  microc_out_len += (size_t)(end - start);
+}
+
+void println(void) {
+  if (MICROC_OUT_CAPACITY <= microc_out_len) {
+    microc_flush();
+  }
+
+  microc_out_buf[microc_out_len++] = '\n';
+}
+
+void flush(void) {
+  microc_flush();
+}
+
+void microc_bounds_fail(int64_t index, int64_t area) {
+  microc_flush();
+  fprintf(stderr, "Index %" PRId64 " out of bounds for array of area %" PRId64 "\n", index, area);
+  exit(1);
+}
+
+int64_t microc_arg(int32_t argc, char **argv, int64_t index) {
+  if (index < argc) {
+    return strtoll(argv[index], NULL, 10);
+  }
+
+  return 0;
+}
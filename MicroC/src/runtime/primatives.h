@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The runtime of microC, as C fns.
+//
+// These are the definitions of foundation fns, see `codegen/primative_fns.cpp` for the codegen side.
+// The runtime is built both into microCJIT, where the JIT finds the fns in the process, and as a standalone archive, which is linked with objects from microCC.
+//
+// In addition to foundation fns, the runtime provides support for entry fns (see `Context::generate_entry`).
+//
+// Output is buffered, and written to stdout when the buffer is full, on `flush`, and on exit.
+// So, anything else writing to stdout should call `microc_flush` first.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// The capacity of the output buffer, in bytes.
+#define MICROC_OUT_CAPACITY (1 << 16)
+
+// The output buffer, and the count of bytes in the buffer.
+extern char microc_out_buf[MICROC_OUT_CAPACITY];
+extern size_t microc_out_len;
+
+// Writes the output buffer to stdout, and empties the buffer.
+void microc_flush(void);
+
+// Prints an integer, followed by a space.
+void printi(int64_t i);
+
+// Prints a new line.
+void println(void);
+
+// Writes any buffered output to stdout.
+void flush(void);
+
+// Reports an index out of bounds for an array with `area`, and exits.
+// Called from checked codegen (see `CodegenOptions`).
+void microc_bounds_fail(int64_t index, int64_t area);
+
+// Returns argument `index` of `argv` read as an integer, or zero if there is no such argument.
+int64_t microc_arg(int32_t argc, char **argv, int64_t index);
+
+#ifdef __cplusplus
+}
+#endif
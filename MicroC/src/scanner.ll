@@ -3,15 +3,13 @@
 #include <string>
 #include "Driver.hpp"
 #include "parser.hpp"
-
-std::string str_buf{};
 %}
 
 %{
 
 %}
 
-%option noyywrap nounput noinput batch debug
+%option noyywrap nounput noinput batch debug reentrant
 
 %x BLOCK_COMMENT
 %x LINE_COMMENT
@@ -66,7 +64,7 @@ name  [a-zA-Z][a-zA-Z_0-9]*
 "void"    return yy::parser::make_VOID    (loc);
 "while"   return yy::parser::make_WHILE   (loc);
 
-{name}    return yy::parser::make_NAME    (yytext, loc);
+{name}    return yy::parser::make_NAME    (drv.ctx.symbols.intern(std::string_view(yytext, yyleng)), loc);
 
 "+"       return yy::parser::make_PLUS         (loc);
 "-"       return yy::parser::make_MINUS        (loc);
@@ -122,25 +120,25 @@ name  [a-zA-Z][a-zA-Z_0-9]*
   "*/" BEGIN(INITIAL);
   "*"     //
   [^\n]   //
-  \n      yylineno++;
+  \n      loc.lines(1); loc.step();
   <<EOF>> { throw yy::parser::syntax_error(loc, "Unterminated comment"); }
 }
 
 <LINE_COMMENT>{
   [^\n]+  //
-  \n      yylineno++; BEGIN(INITIAL);
+  \n      loc.lines(1); loc.step(); BEGIN(INITIAL);
 }
 
 <QUOTES>{
   "\""    {
             BEGIN(INITIAL);
             std::string str{};
-            std::swap(str_buf, str);
+            std::swap(drv.str_buf, str);
             return yy::parser::make_CSTSTRING (str, loc);
           }
-  "\'"    { str_buf.push_back('\\'); str_buf.push_back('\''); }
+  "\'"    { drv.str_buf.push_back('\\'); drv.str_buf.push_back('\''); }
   \n      { throw yy::parser::syntax_error(loc, "Newline in string: " + std::string(yytext)); }
-  [^\"]   str_buf.push_back(*yytext);
+  [^\"]   drv.str_buf.push_back(*yytext);
   <<EOF>> { throw yy::parser::syntax_error(loc, "Unterminated string"); }
 }
 
@@ -152,17 +150,18 @@ name  [a-zA-Z][a-zA-Z_0-9]*
 %%
 
 
-void Driver::scan_begin () {
-  yy_flex_debug = trace_scanning;
-  if (src_file.empty () || src_file == "-") {
-    yyin = stdin;
-  }
-  else if (!(yyin = fopen (src_file.c_str (), "r"))) {
-    std::cerr << "Unable to open " << src_file << ": " << strerror (errno) << '\n';
-    exit(EXIT_FAILURE);
-  }
+// The source is scanned in place, and so is not copied to a buffer of the scanner.
+void Driver::scan_begin (Source &source) {
+  yylex_init(&this->scanner);
+  yyset_debug(trace_scanning, this->scanner);
+
+  // `size + 2`, as the buffer ends with two nulls.
+  yy_scan_buffer(source.buffer(), source.size() + 2, this->scanner);
 }
 
 void Driver::scan_end () {
-  fclose(yyin);
+  if (this->scanner) {
+    yylex_destroy(this->scanner);
+    this->scanner = nullptr;
+  }
 }
@@ -0,0 +1,113 @@
+import argparse
+import json
+import math
+import pathlib
+import subprocess
+import tempfile
+import time
+
+print("Benchmarks for microC using microCJIT")
+
+MICROCJIT = "./build/microCJIT"
+TEST_DIR = pathlib.Path(__file__).parent
+
+# Output heavy sources, with an argument.
+OUTPUT_BENCHES = [
+    ("ex/ex11.c", 11),
+    ("bench/print.c", 1000000),
+]
+
+# Counts of statements in the fn of a generated source, for parse benchmarks.
+PARSE_SIZES = [10000, 20000, 40000, 80000]
+
+
+# The best wall time of `repeat` runs of `source`, and the lines printed.
+def bench_output(jit: str, source: str, arg: int, repeat: int):
+    path = TEST_DIR.joinpath(source)
+    best = math.inf
+    lines = 0
+
+    for _ in range(repeat):
+        start = time.perf_counter()
+        result = subprocess.run([jit, path, str(arg)], capture_output=True, check=True)
+        best = min(best, time.perf_counter() - start)
+        lines = result.stdout.count(b"\n")
+
+    return lines, best
+
+
+def report_output(jit: str, baseline: str | None, repeat: int):
+    for source, arg in OUTPUT_BENCHES:
+        lines, seconds = bench_output(jit, source, arg, repeat)
+        print(f"{source} {arg}: {lines} lines in {seconds:.3f}s, {lines / seconds:.0f} lines/s")
+
+        if baseline:
+            base_lines, base_seconds = bench_output(baseline, source, arg, repeat)
+            print(f"  baseline: {base_lines} lines in {base_seconds:.3f}s, {base_lines / base_seconds:.0f} lines/s")
+            print(f"  speedup: {base_seconds / seconds:.2f}x")
+
+
+# A source with a fn of `statements` statements, with a nested block declaring a local every hundred statements.
+# The fn is never called, so (with the lazy JIT) the fn is parsed and generated but not compiled.
+def parse_source(statements: int):
+    lines = ["void f(int x) {"]
+
+    for i in range(statements):
+        if i % 100 == 0:
+            lines.append("  { int y; y = x; x = y + 1; }")
+        else:
+            lines.append(f"  x = x + {i % 10};")
+
+    lines.append("}")
+    lines.append("")
+    lines.append("void main() {")
+    lines.append("}")
+
+    return "\n".join(lines) + "\n"
+
+
+# The best time of the parse phase of `repeat` runs of `path`, from the report.
+def bench_parse(jit: str, path: pathlib.Path, repeat: int):
+    best = math.inf
+
+    with tempfile.TemporaryDirectory() as tmp:
+        out = pathlib.Path(tmp).joinpath("report.json")
+
+        for _ in range(repeat):
+            subprocess.run([jit, f"--report-json={out}", path], capture_output=True, check=True)
+            report = json.loads(out.read_text())
+            parse_ms = next(phase["wall_ms"] for phase in report["phases"] if phase["name"] == "parse")
+            best = min(best, parse_ms / 1000)
+
+    return best
+
+
+# With linear scaling the time for each statement is (roughly) constant over sizes.
+def report_parse(jit: str, baseline: str | None, repeat: int):
+    with tempfile.TemporaryDirectory() as tmp:
+        for statements in PARSE_SIZES:
+            path = pathlib.Path(tmp).joinpath(f"parse_{statements}.c")
+            path.write_text(parse_source(statements))
+
+            seconds = bench_parse(jit, path, repeat)
+            print(f"parse {statements} statements: {seconds:.3f}s, {seconds / statements * 1e9:.0f} ns/statement")
+
+            if baseline:
+                base_seconds = bench_parse(baseline, path, repeat)
+                print(f"  baseline: {base_seconds:.3f}s, {base_seconds / statements * 1e9:.0f} ns/statement")
+                print(f"  speedup: {base_seconds / seconds:.2f}x")
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--jit", default=MICROCJIT, help="microCJIT to benchmark")
+    parser.add_argument("--baseline", default=None, help="microCJIT to compare with, e.g. from an earlier build")
+    parser.add_argument("--repeat", type=int, default=5)
+    parser.add_argument("--bench", choices=["all", "output", "parse"], default="all")
+    args = parser.parse_args()
+
+    if args.bench in ["all", "output"]:
+        report_output(args.jit, args.baseline, args.repeat)
+
+    if args.bench in ["all", "parse"]:
+        report_parse(args.jit, args.baseline, args.repeat)
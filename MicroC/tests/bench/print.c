@@ -0,0 +1,16 @@
+// Output heavy, printing n rows of ten ints.
+
+void main(int n) {
+  int i;
+  int j;
+  i = 0;
+  while (i < n) {
+    j = 0;
+    while (j < 10) {
+      print i * 10 + j;
+      j += 1;
+    }
+    println;
+    i += 1;
+  }
+}
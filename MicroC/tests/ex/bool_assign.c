@@ -0,0 +1,10 @@
+// A condition assigned to an int, to a variable and to an element of an array.
+
+void main(int n) {
+  int b;
+  int a[2];
+  b = n < 3;
+  a[1] = n == 0;
+  print b;
+  print a[1];
+}
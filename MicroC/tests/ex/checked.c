@@ -0,0 +1,15 @@
+// With `--checked`, writes past the area of `a` stop the program, rather than writing over the stack.
+
+void main(int n) {
+  int a[10];
+  int i;
+  int sum;
+  i = 0;
+  sum = 0;
+  while (i < n) {
+    a[i] = i;
+    sum = sum + a[i];
+    i = i + 1;
+  }
+  print sum;
+}
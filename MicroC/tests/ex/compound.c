@@ -0,0 +1,31 @@
+// Compound assignment, on ints, array elements, and pointers.
+
+void main(int n) {
+  int a[3];
+  int *p;
+  int i;
+
+  i = 0;
+  while (i < 3) {
+    a[i] = i;
+    i += 1;
+  }
+
+  a[0] -= 5;
+  a[1] += n;
+  a[2] *= 3;
+  print a[0];
+  print a[1];
+  print a[2];
+
+  p = &a[0];
+  p += 2;
+  print *p;
+  p -= 1;
+  print *p;
+
+  n /= 2;
+  print n;
+  n %= 2;
+  print n;
+}
@@ -0,0 +1,13 @@
+// Output written before `flush()` arrives, even if the program does not exit normally.
+// With `--checked` and an index past the area of `a` the program stops, and with an index of 1 the program never exits.
+
+void main(int n) {
+  int a[2];
+  print 1;
+  flush();
+  print 2;
+  a[n] = 3;
+  while (n == 1) {
+    a[0] = a[0] + 1;
+  }
+}
@@ -0,0 +1,12 @@
+// Locals declared in a loop body are allocated once, and so the loop runs in constant stack space.
+
+void main(int n) {
+  int i;
+  i = 0;
+  while (i < n) {
+    int a[100];
+    a[i % 100] = i;
+    i = i + 1;
+  }
+  print i;
+}
@@ -0,0 +1,31 @@
+// Fns and globals which are spread over partitions with `--jobs`.
+
+int total;
+
+int square(int n) {
+  return n * n;
+}
+
+int cube(int n) {
+  return n * square(n);
+}
+
+void add(int n) {
+  total = total + n;
+}
+
+int fib(int n) {
+  if (n < 2)
+    return n;
+  return fib(n - 1) + fib(n - 2);
+}
+
+void main(int n) {
+  int i;
+  i = 0;
+  while (i < n) {
+    add(cube(i) + fib(i));
+    i = i + 1;
+  }
+  print total;
+}
@@ -0,0 +1,9 @@
+// A pure fn, with attributes inferred.
+
+int square(int x) {
+  return x * x;
+}
+
+void main(int n) {
+  print square(n);
+}
@@ -0,0 +1,33 @@
+// Names are restored on exit of a scope, whether shadowing a global, an arg, or a local.
+
+int x;
+
+void f(int x) {
+  print x;
+  {
+    int x;
+    x = 3;
+    print x;
+    {
+      int x;
+      x = 4;
+      print x;
+    }
+    print x;
+  }
+  print x;
+}
+
+void main(int n) {
+  x = 1;
+  f(2);
+  print x;
+  {
+    int y;
+    int x;
+    y = n;
+    x = y;
+    print x;
+  }
+  print x;
+}
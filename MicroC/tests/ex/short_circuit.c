@@ -0,0 +1,14 @@
+// The rhs of && and || is evaluated only if required.
+
+int f(int x) {
+  print x;
+  return 1;
+}
+
+void main(int n) {
+  if (n == 0 && f(1))
+    print 2;
+  if (n == 0 || f(3))
+    print 4;
+  println;
+}
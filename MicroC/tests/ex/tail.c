@@ -0,0 +1,11 @@
+// A call in return position is a tail call, and so recursion runs in constant stack.
+
+int count(int n, int acc) {
+  if (n == 0)
+    return acc;
+  return count(n - 1, acc + 1);
+}
+
+void main(int n) {
+  print count(n, 0);
+}
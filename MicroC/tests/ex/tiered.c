@@ -0,0 +1,17 @@
+// A hot fn, called through its slot, which tiers up while main runs at tier 0.
+
+int step(int x) {
+  return (x * 7 + 3) % 1000;
+}
+
+void main(int n) {
+  int i;
+  int x;
+  i = 0;
+  x = 0;
+  while (i < n) {
+    x = step(x);
+    i = i + 1;
+  }
+  print x;
+}
@@ -1,10 +1,14 @@
+import json
 import pathlib
+import re
 import subprocess
+import tempfile
 import unittest
 
 print("Source tests for microC using microCJIT")
 
 MICROCJIT = "./build/microCJIT"
+MICROCC = "./build/microCC"
 TEST_DIR = pathlib.Path(__file__).parent
 
 
@@ -18,6 +22,26 @@ def run_source(source: str, arg: int = 0):
     return result
 
 
+def run_source_args(source: str, *args: int):
+    path = TEST_DIR.joinpath(source)
+    result = subprocess.run([MICROCJIT, path, *map(str, args)], capture_output=True)
+
+    if result.stderr:
+        print(f"\nError: {result.stderr.decode()}")
+
+    return result
+
+
+def run_aot(source: str, out: pathlib.Path, arg: int = 0):
+    path = TEST_DIR.joinpath(source)
+    compiled = subprocess.run([MICROCC, "-o", out, path], capture_output=True)
+
+    if compiled.stderr:
+        print(f"\nError: {compiled.stderr.decode()}")
+
+    return subprocess.run([out, str(arg)], capture_output=True)
+
+
 class One(unittest.TestCase):
     def test_10(self):
         result = run_source("ex/ex1.c", 10)
@@ -189,13 +213,24 @@ class Seventeen(unittest.TestCase):
         self.assertEqual(stdout, b"2 1 999999")
 
 
-# FIXME: Requires support for multiple arguments
-# class Eighteen(unittest.TestCase):
-#     def test_0_1(self):
-#         # result = run_source("ex/ex15.c", 2)
-#         # stdout = result.stdout.strip()
+class Eighteen(unittest.TestCase):
+    def test_0_0(self):
+        result = run_source_args("ex/ex18.c", 0, 0)
+        stdout = result.stdout.strip()
+
+        self.assertEqual(stdout, b"1111")
+
+    def test_1_0(self):
+        result = run_source_args("ex/ex18.c", 1, 0)
+        stdout = result.stdout.strip()
+
+        self.assertEqual(stdout, b"3333")
 
-#         self.assertTrue(False)
+    def test_0_1(self):
+        result = run_source_args("ex/ex18.c", 0, 1)
+        stdout = result.stdout.strip()
+
+        self.assertEqual(stdout, b"")
 
 
 class Nineteen(unittest.TestCase):
@@ -212,13 +247,262 @@ class Nineteen(unittest.TestCase):
         self.assertEqual(stdout, b"44")
 
 
-# FIXME: Requires support for multiple arguments
-# class Twenty(unittest.TestCase):
-#     def test_0_1(self):
-#         # result = run_source("ex/ex15.c", 2)
-#         # stdout = result.stdout.strip()
+class Twenty(unittest.TestCase):
+    def test_0_0(self):
+        result = run_source_args("ex/ex20.c", 0, 0)
+        stdout = result.stdout.strip()
+
+        self.assertEqual(stdout, b"1111 1")
+
+    def test_0_1(self):
+        result = run_source_args("ex/ex20.c", 0, 1)
+        stdout = result.stdout.strip()
+
+        self.assertEqual(stdout, b"2222 0")
+
+
+class BoolAssign(unittest.TestCase):
+    def test_0(self):
+        result = run_source("ex/bool_assign.c", 0)
+        stdout = result.stdout.strip()
+
+        self.assertEqual(stdout, b"1 1")
+
+    def test_5(self):
+        result = run_source("ex/bool_assign.c", 5)
+        stdout = result.stdout.strip()
+
+        self.assertEqual(stdout, b"0 0")
+
+
+class ShortCircuit(unittest.TestCase):
+    def test_0(self):
+        result = run_source("ex/short_circuit.c", 0)
+        stdout = result.stdout.strip()
+
+        self.assertEqual(stdout, b"1 2 4")
+
+    def test_1(self):
+        result = run_source("ex/short_circuit.c", 1)
+        stdout = result.stdout.strip()
+
+        self.assertEqual(stdout, b"3 4")
+
+
+class Compound(unittest.TestCase):
+    def test_7(self):
+        result = run_source("ex/compound.c", 7)
+        stdout = result.stdout.strip()
+
+        self.assertEqual(stdout, b"-5 8 6 6 8 3 1")
+
+
+class Tail(unittest.TestCase):
+    def test_deep_recursion(self):
+        path = TEST_DIR.joinpath("ex/tail.c")
+        result = subprocess.run([MICROCJIT, "-O0", path, "10000000"], capture_output=True)
+        stdout = result.stdout.strip()
+
+        self.assertEqual(stdout, b"10000000")
+
+
+class Attributes(unittest.TestCase):
+    def test_memory_none(self):
+        path = TEST_DIR.joinpath("ex/pure.c")
+        result = subprocess.run([MICROCJIT, "-m", path, "3"], capture_output=True)
 
-#         self.assertTrue(False)
+        generated, inferred = result.stdout.split(b"The module, with inferred attributes:")
+
+        self.assertNotIn(b"memory(none)", generated)
+        self.assertIn(b"memory(none)", inferred)
+        self.assertTrue(result.stdout.strip().endswith(b"9"))
+
+
+class Locals(unittest.TestCase):
+    def test_loop_stack(self):
+        path = TEST_DIR.joinpath("ex/locals.c")
+        result = subprocess.run([MICROCJIT, "-O0", path, "1000000"], capture_output=True)
+        stdout = result.stdout.strip()
+
+        self.assertEqual(stdout, b"1000000")
+
+
+class Shadow(unittest.TestCase):
+    def test_5(self):
+        result = run_source("ex/shadow.c", 5)
+        stdout = result.stdout.strip()
+
+        self.assertEqual(stdout, b"2 3 4 3 2 1 5 1")
+
+
+class Source(unittest.TestCase):
+    def test_stdin(self):
+        source = TEST_DIR.joinpath("ex/ex1.c").read_bytes()
+        result = subprocess.run([MICROCJIT, "-", "3"], input=source, capture_output=True)
+
+        self.assertEqual(result.stdout, b"3 2 1 \n")
+
+    # Large sources are mapped, rather than read.
+    def test_mapped(self):
+        source = TEST_DIR.joinpath("ex/ex1.c").read_text()
+        with tempfile.NamedTemporaryFile("w", suffix=".c") as padded:
+            padded.write("/*" + " " * 20000 + "*/\n" + source)
+            padded.flush()
+            result = subprocess.run([MICROCJIT, padded.name, "3"], capture_output=True)
+
+        self.assertEqual(result.stdout, b"3 2 1 \n")
+
+
+class Checked(unittest.TestCase):
+    def test_in_bounds(self):
+        path = TEST_DIR.joinpath("ex/checked.c")
+        result = subprocess.run([MICROCJIT, "--checked", path, "10"], capture_output=True)
+
+        self.assertEqual(result.returncode, 0)
+        self.assertEqual(result.stdout.strip(), b"45")
+
+    def test_out_of_bounds(self):
+        path = TEST_DIR.joinpath("ex/checked.c")
+        result = subprocess.run([MICROCJIT, "--checked", path, "11"], capture_output=True)
+
+        self.assertNotEqual(result.returncode, 0)
+        self.assertIn(b"Index 10 out of bounds", result.stderr)
+
+
+class Flush(unittest.TestCase):
+    def test_out_of_bounds(self):
+        path = TEST_DIR.joinpath("ex/flush.c")
+        result = subprocess.run([MICROCJIT, "--checked", path, "2"], capture_output=True)
+
+        self.assertNotEqual(result.returncode, 0)
+        self.assertTrue(result.stdout.startswith(b"1 "))
+        self.assertIn(b"Index 2 out of bounds", result.stderr)
+
+    def test_killed(self):
+        # The program never exits, and is killed, so only output written by `flush()` arrives.
+        path = TEST_DIR.joinpath("ex/flush.c")
+        with self.assertRaises(subprocess.TimeoutExpired) as killed:
+            subprocess.run([MICROCJIT, path, "1"], capture_output=True, timeout=2)
+
+        self.assertEqual(killed.exception.stdout, b"1 ")
+
+
+class PGO(unittest.TestCase):
+    def test_ex11(self):
+        path = TEST_DIR.joinpath("ex/ex11.c")
+        with tempfile.TemporaryDirectory() as tmp:
+            profile = pathlib.Path(tmp).joinpath("ex11.profile")
+            generate = subprocess.run([MICROCJIT, f"--pgo-generate={profile}", path, "6"], capture_output=True)
+            profile_text = profile.read_text()
+            use = subprocess.run([MICROCJIT, f"--pgo-use={profile}", path, "6"], capture_output=True)
+
+        self.assertIn("fn main 1 ", profile_text)
+        self.assertEqual(generate.stdout, use.stdout)
+        self.assertEqual(len(use.stdout.strip().split(b"\n")), 4)
+
+    def test_instrumented_attributes(self):
+        # Counters are writes, and so an instrumented fn does not have attributes inferred as if pure.
+        path = TEST_DIR.joinpath("ex/pure.c")
+        with tempfile.TemporaryDirectory() as tmp:
+            profile = pathlib.Path(tmp).joinpath("pure.profile")
+            result = subprocess.run([MICROCJIT, "-m", f"--pgo-generate={profile}", path, "3"], capture_output=True)
+            profile_text = profile.read_text()
+
+        generated, inferred = result.stdout.split(b"The module, with inferred attributes:")
+
+        self.assertNotIn(b"memory(none)", inferred)
+        self.assertIn("fn square 1 ", profile_text)
+
+
+class Tiered(unittest.TestCase):
+    def test_ex11(self):
+        path = TEST_DIR.joinpath("ex/ex11.c")
+        baseline = subprocess.run([MICROCJIT, path, "8"], capture_output=True)
+        tiered = subprocess.run([MICROCJIT, "--tier-threshold=10", path, "8"], capture_output=True)
+        verbose = subprocess.run([MICROCJIT, "-v", "--tier-threshold=10", path, "8"], capture_output=True)
+
+        self.assertEqual(tiered.returncode, 0)
+        self.assertEqual(tiered.stdout, baseline.stdout)
+        self.assertEqual(len(tiered.stdout.strip().split(b"\n")), 92)
+        self.assertNotIn(b"Tier up of", verbose.stderr)
+
+    def test_tier_up(self):
+        path = TEST_DIR.joinpath("ex/tiered.c")
+        baseline = subprocess.run([MICROCJIT, path, "10000000"], capture_output=True)
+        tiered = subprocess.run([MICROCJIT, "-v", "--tier-threshold=10", path, "10000000"], capture_output=True)
+
+        self.assertEqual(tiered.returncode, 0)
+        self.assertIn(b"Tier up: step", tiered.stderr)
+        self.assertNotIn(b"Tier up of", tiered.stderr)
+        self.assertIn(baseline.stdout, tiered.stdout)
+
+
+class Jobs(unittest.TestCase):
+    def test_partitions(self):
+        path = TEST_DIR.joinpath("ex/partitions.c")
+        for jobs in [1, 2, 4]:
+            result = subprocess.run([MICROCJIT, f"--jobs={jobs}", path, "10"], capture_output=True)
+
+            self.assertEqual(result.stdout.strip(), b"2113")
+
+    def test_attributes(self):
+        # cube is defined in the second partition, and is pure only if the attributes of square, defined in the first, are copied.
+        path = TEST_DIR.joinpath("ex/partitions.c")
+        result = subprocess.run([MICROCJIT, "-m", "--jobs=2", path, "10"], capture_output=True)
+        modules = result.stdout.split(b"The module, with inferred attributes:")[1:]
+
+        cube = [module for module in modules if re.search(rb"define [^\n]*@cube\(", module)]
+        self.assertEqual(len(cube), 1)
+
+        group = re.search(rb"define [^\n]*@cube\([^\n]*\) (#\d+)", cube[0]).group(1)
+        attributes = re.search(rb"attributes " + group + rb" = \{([^\n]*)\}", cube[0]).group(1)
+        self.assertIn(b"memory(none)", attributes)
+
+
+class Perf(unittest.TestCase):
+    def test_map(self):
+        path = TEST_DIR.joinpath("ex/ex1.c")
+        process = subprocess.Popen([MICROCJIT, "--perf", path, "3"], stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+        stdout, _ = process.communicate()
+        perf_map = pathlib.Path(f"/tmp/perf-{process.pid}.map")
+        names = [line.split()[2] for line in perf_map.read_text().splitlines()]
+        perf_map.unlink()
+
+        self.assertEqual(stdout, b"3 2 1 \n")
+        self.assertIn("main", names)
+
+
+class Profile(unittest.TestCase):
+    def test_json(self):
+        path = TEST_DIR.joinpath("ex/ex1.c")
+        with tempfile.TemporaryDirectory() as tmp:
+            out = pathlib.Path(tmp).joinpath("profile.json")
+            result = subprocess.run([MICROCJIT, f"--profile-json={out}", path, "3"], capture_output=True)
+            profile = json.loads(out.read_text())
+
+        self.assertEqual(result.stdout, b"3 2 1 \n")
+        sites = [(site["kind"], site["fn"], site["line"], site["count"]) for site in profile["sites"]]
+        self.assertEqual(sites, [("loop", "main", 4, 3), ("fn", "main", 3, 1)])
+
+
+class Batch(unittest.TestCase):
+    def test_ex18(self):
+        path = TEST_DIR.joinpath("ex/ex18.c")
+        with tempfile.NamedTemporaryFile("w", suffix=".txt") as batch:
+            batch.write("0 0\n1 0\n0 1\n")
+            batch.flush()
+            result = subprocess.run(
+                [MICROCJIT, f"--batch={batch.name}", "--batch-sep=--", path],
+                capture_output=True,
+            )
+
+        self.assertEqual(result.stdout, b"1111 --\n3333 --\n--\n")
+
+    def test_args(self):
+        path = TEST_DIR.joinpath("ex/ex1.c")
+        result = subprocess.run([MICROCJIT, "--batch-args", path, "3", "3"], capture_output=True)
+
+        self.assertEqual(result.stdout, b"3 2 1 \n3 2 1 \n")
 
 
 class TwentyOne(unittest.TestCase):
@@ -265,5 +549,45 @@ class TwentyFour(unittest.TestCase):
         self.assertEqual(stdout, b"125 1021")
 
 
+class Report(unittest.TestCase):
+    def test_json(self):
+        path = TEST_DIR.joinpath("ex/ex1.c")
+        with tempfile.TemporaryDirectory() as tmp:
+            out = pathlib.Path(tmp).joinpath("report.json")
+            result = subprocess.run([MICROCJIT, f"--report-json={out}", path, "3"], capture_output=True)
+            report = json.loads(out.read_text())
+
+        self.assertEqual(result.stdout, b"3 2 1 \n")
+        phases = [phase["name"] for phase in report["phases"]]
+        self.assertEqual(
+            phases,
+            [
+                "parse",
+                "generate_ir",
+                "verify",
+                "infer_attributes",
+                "build_execution_engine",
+                "execute_main",
+            ],
+        )
+        self.assertIn("main", [fn["name"] for fn in report["fns"]])
+        self.assertGreater(report["code_size"], 0)
+
+
+class AOT(unittest.TestCase):
+    def test_ex1(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            result = run_aot("ex/ex1.c", pathlib.Path(tmp).joinpath("ex1"), 10)
+            stdout = result.stdout.strip()
+
+            self.assertEqual(stdout, b"10 9 8 7 6 5 4 3 2 1")
+
+    def test_ex12(self):
+        with tempfile.TemporaryDirectory() as tmp:
+            result = run_aot("ex/ex12.c", pathlib.Path(tmp).joinpath("ex12"), 5)
+
+            self.assertEqual(result.returncode, 17)
+
+
 if __name__ == "__main__":
     _ = unittest.main()